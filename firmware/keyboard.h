@@ -30,12 +30,15 @@
 #ifndef OPT__KB__COLUMNS
     #error  "OPT__KB__COLUMNS not defined"
 #endif
+#if OPT__KB__COLUMNS > 16
+    #error  "OPT__KB__COLUMNS must be <= 16 (one `uint16_t` per row)"
+#endif
 
 // ----------------------------------------------------------------------------
 
 // controller
 uint8_t kb__init          (void);
-uint8_t kb__update_matrix (bool matrix[OPT__KB__ROWS][OPT__KB__COLUMNS]);
+uint8_t kb__update_matrix (uint16_t matrix[OPT__KB__ROWS]);
 
 // LED
 void kb__led__on  (uint8_t led);
@@ -82,6 +85,10 @@ void kb__layout__exec_key (bool pressed, uint8_t row, uint8_t column);
 // === OPT__KB__COLUMNS ===
 /**                                         macros/OPT__KB__COLUMNS/description
  * The number of columns in a given keyboard's matrix
+ *
+ * Notes:
+ * - Must be no more than 16: each row of the matrix is kept as a bitmask, in
+ *   a `uint16_t`.
  */
 
 
@@ -110,7 +117,8 @@ void kb__layout__exec_key (bool pressed, uint8_t row, uint8_t column);
  * Update the given matrix to the current state of the keyboard.
  *
  * Arguments:
- * - `matrix`: The keyboard matrix to update.
+ * - `matrix`: The keyboard matrix to update: one bitmask per row, with bit
+ *   `n` set if the key in column `n` is pressed.
  *
  * Returns:
  * - success: `0`
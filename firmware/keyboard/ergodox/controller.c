@@ -9,31 +9,75 @@
  */
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "./controller/mcp23018.h"
 #include "./controller/teensy-2-0.h"
+#include "../../../firmware/lib/layout/eeprom-layout.h"
 #include "../../../firmware/lib/layout/eeprom-macro.h"
+#include "../../../firmware/lib/profile.h"
+#include "../../../firmware/lib/twi.h"
 #include "../../../firmware/keyboard.h"
 
 // ----------------------------------------------------------------------------
 
+/**                                                  variables/scan/description
+ * The state of the Teensy half of the scan in progress
+ *
+ * Struct members:
+ * - `matrix`: The matrix being updated
+ * - `strobe`: The next strobe to perform
+ */
+static struct {
+    uint16_t * matrix;
+    uint8_t    strobe;
+} scan;
+
+// ----------------------------------------------------------------------------
+
+/**                                           functions/teensy_step/description
+ * Perform the next strobe of the Teensy half of the scan, if there is one
+ *
+ * Notes:
+ * - Run (as the TWI wait hook) while the MCP23018 half of the scan is waiting
+ *   on the bus, so that the two halves are scanned at the same time.
+ */
+static void teensy_step(void) {
+    if (scan.strobe < TEENSY__STROBES)
+        teensy__strobe(scan.matrix, scan.strobe++);
+}
+
+// ----------------------------------------------------------------------------
+
 uint8_t kb__init(void) {
     if (teensy__init())    // must be first (to initialize twi, and such)
         return 1;
     if (mcp23018__init())  // must be second
         return 2;
 
+    eeprom_layout__init();
     eeprom_macro__init();
 
     return 0;  // success
 }
 
-uint8_t kb__update_matrix(bool matrix[OPT__KB__ROWS][OPT__KB__COLUMNS]) {
-    if (teensy__update_matrix(matrix))
-        return 1;
+uint8_t kb__update_matrix(uint16_t matrix[OPT__KB__ROWS]) {
+    uint8_t ret = 0;  // success
+
+    // scan the left half, strobing the right half while waiting on the bus
+    scan.matrix = matrix;
+    scan.strobe = 0;
+    twi__set_wait_hook(&teensy_step);
     if (mcp23018__update_matrix(matrix))
-        return 2;
+        ret = 2;
+    twi__set_wait_hook(NULL);
+    profile__mark(PROFILE__MCP23018);
 
-    return 0;  // success
+    // finish the right half (if the left half finished first)
+    while (scan.strobe < TEENSY__STROBES)
+        teensy_step();
+    profile__mark(PROFILE__TEENSY);
+
+    return ret;
 }
 
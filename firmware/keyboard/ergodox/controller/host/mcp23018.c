@@ -0,0 +1,254 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * Implements the TWI part of the "board" section of
+ * ".../firmware/lib/host.h": a register level model of the MCP23018 on the
+ * left half of the ErgoDox
+ *
+ * Notes:
+ * - The pin assignments must match those in "../mcp23018.md".  Switches and
+ *   diodes are ideal (see "./teensy-2-0.c").
+ * - Registers are addressed as with `IOCON.BANK = 0`; setting `BANK` is
+ *   ignored.  With `IOCON.SEQOP = 0` the register pointer increments after
+ *   each byte (wrapping from `OLATB` to `IODIRA`), and with `SEQOP = 1` it
+ *   toggles between the A and B registers of a pair.
+ * - Outputs are open drain, as on the chip: a pin is only driven low if it's
+ *   an output (`IODIR = 0`) with its latch low (`OLAT = 0`).  Anything else
+ *   reads high unless something's pulling it low (with or without the
+ *   pull-up enabled, since a floating pin could read either way).
+ * - Interrupt-on-change is modeled (`GPINTEN`, `DEFVAL`, `INTCON`, `INTF`,
+ *   `INTCAP`, and `IOCON.INTCC`), but the pins are only compared when
+ *   something's sent or read over the bus, so changes that come and go
+ *   between two transfers are missed.  The `INT` pins aren't connected, so
+ *   they aren't modeled.
+ * - While the left half is unplugged (see `host__twi__fault()`), nothing is
+ *   ACKed, and once it's plugged in again, every register is back to its
+ *   power on value.
+ */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../../../../../firmware/keyboard.h"
+#include "../../../../../firmware/lib/host.h"
+
+// ----------------------------------------------------------------------------
+
+// register addresses (with `IOCON.BANK = 0`; see "../mcp23018.md")
+#define  IODIRA    0x00  // i/o direction register
+#define  IPOLA     0x02  // input polarity register
+#define  GPINTENA  0x04  // interrupt-on-change enable register
+#define  DEFVALA   0x06  // default compare register for interrupt-on-change
+#define  INTCONA   0x08  // interrupt control register
+#define  IOCON     0x0A  // i/o expander configuration register (also `0x0B`)
+#define  GPPUA     0x0C  // GPIO pull-up resistor register
+#define  INTFA     0x0E  // interrupt flag register
+#define  INTCAPA   0x10  // interrupt captured value register
+#define  GPIOA     0x12  // general purpose i/o port register
+#define  OLATA     0x14  // output latch register
+
+#define  REGISTERS  0x16
+
+// the B register of each pair is at the A register's address + 1
+#define  B  1
+
+// IOCON bits
+#define  BANK   7
+#define  SEQOP  5
+#define  INTCC  0
+
+/**                                                 macros/TWI_ADDR/description
+ * The MCP23018's 7-bit address (with `ADDR` tied to Vss)
+ */
+#define  TWI_ADDR  0b0100000
+
+/**                                         macros/MCP23018_COLUMNS/description
+ * The number of matrix columns wired to the MCP23018 (the first ones; each on
+ * the `GPA` pin of the same number)
+ */
+#define  MCP23018_COLUMNS  7
+
+/**                                                  macros/ROW_PIN/description
+ * The `GPB` pin the given row is wired to
+ */
+#define  ROW_PIN(row)  (5-(row))
+
+// ----------------------------------------------------------------------------
+
+/**                                                  variables/chip/description
+ * The state of the MCP23018
+ *
+ * Struct members:
+ * - `reg`: The registers, by address (`IOCON` is stored at `IOCON`)
+ * - `pointer`: The register pointer
+ * - `addressed`: Whether the next byte written is a register address
+ * - `last`: The value of each port when the pins were last compared (for
+ *   interrupts that compare against the previous value)
+ * - `powered`: Whether the chip has been powered since the last reset (see
+ *   `reset()`)
+ */
+static struct {
+    uint8_t reg[REGISTERS];
+    uint8_t pointer;
+    bool    addressed;
+    uint8_t last[2];
+    bool    powered;
+} chip;
+
+// ----------------------------------------------------------------------------
+
+/**                                                 functions/reset/description
+ * Put every register back to its power on value
+ */
+static void reset(void) {
+    for (uint8_t i = 0; i < REGISTERS; i++)
+        chip.reg[i] = 0;
+    chip.reg[IODIRA]   = 0xFF;
+    chip.reg[IODIRA+B] = 0xFF;
+
+    chip.pointer = 0;
+    chip.last[0] = chip.last[1] = 0xFF;
+    chip.powered = true;
+}
+
+/**                                                  functions/pins/description
+ * Work out the level of every pin
+ *
+ * Arguments:
+ * - `level`: Where to put the levels of port A and port B (`1` for high)
+ */
+static void pins(uint8_t level[2]) {
+    uint8_t driven[2];
+
+    for (uint8_t p = 0; p < 2; p++) {
+        driven[p] = ~chip.reg[IODIRA+p] & ~chip.reg[OLATA+p];
+        level[p] = ~driven[p];
+    }
+
+    for (uint8_t r = 0; r < OPT__KB__ROWS; r++) {
+        for (uint8_t c = 0; c < MCP23018_COLUMNS; c++) {
+            if (!host__matrix__is_pressed(r, c))
+                continue;
+
+            if (driven[0] & (1<<c))
+                level[1] &= ~(1<<ROW_PIN(r));
+            if (driven[1] & (1<<ROW_PIN(r)))
+                level[0] &= ~(1<<c);
+        }
+    }
+}
+
+/**                                               functions/compare/description
+ * Compare the pins, for interrupt-on-change, and flag (and capture) any
+ * changes
+ *
+ * Notes:
+ * - As on the chip, once a port has flagged an interrupt, nothing new is
+ *   flagged (or captured) until the interrupt is cleared.
+ */
+static void compare(void) {
+    uint8_t level[2];
+    pins(level);
+
+    for (uint8_t p = 0; p < 2; p++) {
+        uint8_t changed = ( ( level[p] ^ chip.reg[DEFVALA+p] )
+                            &  chip.reg[INTCONA+p] )
+                        | ( ( level[p] ^ chip.last[p] )
+                            & ~chip.reg[INTCONA+p] );
+        changed &= chip.reg[GPINTENA+p] & chip.reg[IODIRA+p];
+
+        if (changed && !chip.reg[INTFA+p]) {
+            chip.reg[INTFA+p]   = changed;
+            chip.reg[INTCAPA+p] = level[p] ^ chip.reg[IPOLA+p];
+        }
+
+        chip.last[p] = level[p];
+    }
+}
+
+/**                                               functions/advance/description
+ * Move the register pointer on, after a byte has been written or read
+ */
+static void advance(void) {
+    if (chip.reg[IOCON] & (1<<SEQOP))
+        chip.pointer ^= B;
+    else
+        chip.pointer = (chip.pointer + 1) % REGISTERS;
+}
+
+// ----------------------------------------------------------------------------
+
+bool host__board__twi_address(uint8_t address) {
+    if (host__twi__fault(HOST__TWI__UNPLUGGED)) {
+        chip.powered = false;
+        return false;  // nobody there
+    }
+    if (!chip.powered)
+        reset();
+
+    if ((address >> 1) != TWI_ADDR)
+        return false;  // not us
+
+    chip.addressed = !(address & 1);  // (a write starts with a register)
+    compare();
+    return true;
+}
+
+bool host__board__twi_write(uint8_t data) {
+    if (chip.addressed) {
+        chip.addressed = false;
+        if (data >= REGISTERS)
+            return false;  // error: no such register
+        chip.pointer = data;
+        return true;
+    }
+
+    uint8_t reg = chip.pointer;
+    if ((reg & ~B) == IOCON) {
+        reg = IOCON;
+        data &= ~(1<<BANK);
+    }
+    if ((reg & ~B) == GPIOA)
+        reg += OLATA - GPIOA;  // (writes to `GPIO` go to `OLAT`)
+
+    if ((reg & ~B) != INTFA && (reg & ~B) != INTCAPA)  // (read only)
+        chip.reg[reg] = data;
+
+    advance();
+    compare();
+    return true;
+}
+
+uint8_t host__board__twi_read(void) {
+    uint8_t reg = chip.pointer;
+    uint8_t port = reg & B;
+    uint8_t data;
+
+    compare();
+
+    if ((reg & ~B) == IOCON)
+        reg = IOCON;
+
+    if ((reg & ~B) == GPIOA) {
+        uint8_t level[2];
+        pins(level);
+        data = level[port] ^ (chip.reg[IPOLA+port] & chip.reg[IODIRA+port]);
+    } else {
+        data = chip.reg[reg];
+    }
+
+    // reading `GPIO` (or, with `INTCC` set, `INTCAP`) clears the interrupt
+    if ( (reg & ~B) == ( chip.reg[IOCON] & (1<<INTCC) ? INTCAPA : GPIOA ) )
+        chip.reg[INTFA+port] = 0;
+
+    advance();
+    return data;
+}
+
+void host__board__twi_stop(void) {
+    compare();
+}
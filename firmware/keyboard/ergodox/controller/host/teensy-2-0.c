@@ -0,0 +1,86 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * Implements the pin part of the "board" section of ".../firmware/lib/host.h"
+ * for the Teensy half of the ErgoDox (the left half is modeled on the TWI bus,
+ * in "./mcp23018.c")
+ *
+ * Notes:
+ * - The pin assignments must match those in "../teensy-2-0.c".
+ * - Switches and diodes are ideal: a pressed key connects its row and column
+ *   pins, so whichever of the two is driven low pulls the other low.  This
+ *   works for either pin drive direction.
+ */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../../../../../firmware/keyboard.h"
+#include "../../../../../firmware/lib/host.h"
+
+// ----------------------------------------------------------------------------
+
+/**                                                     types/pin_t/description
+ * To hold the location of a pin
+ *
+ * Struct members:
+ * - `port`: The index of the port (`port letter - 'A'`)
+ * - `bit`: The bit of the pin within the port
+ */
+typedef struct {
+    uint8_t port;
+    uint8_t bit;
+} pin_t;
+
+// ----------------------------------------------------------------------------
+
+/**                                 variables/(group) pin locations/description
+ * Where each row, and each Teensy column, is wired
+ */
+static const pin_t rows[OPT__KB__ROWS] = {
+    { 'F'-'A', 7 }, { 'F'-'A', 6 }, { 'F'-'A', 5 },
+    { 'F'-'A', 4 }, { 'F'-'A', 1 }, { 'F'-'A', 0 },
+};
+static const pin_t columns[] = {
+    { 'B'-'A', 0 }, { 'B'-'A', 1 }, { 'B'-'A', 2 }, { 'B'-'A', 3 },
+    { 'D'-'A', 2 }, { 'D'-'A', 3 }, { 'C'-'A', 6 },
+};
+
+/**                                             macros/FIRST_COLUMN/description
+ * The first matrix column wired to the Teensy (the rest are on the MCP23018)
+ */
+#define  FIRST_COLUMN  0x7
+
+// ----------------------------------------------------------------------------
+
+/**                                            functions/driven_low/description
+ * Return whether the given pin is an output, driven low
+ */
+static bool driven_low(pin_t pin) {
+    return  ( host__io.ddr[pin.port]  & (1<<pin.bit) )
+        && !( host__io.port[pin.port] & (1<<pin.bit) );
+}
+
+// ----------------------------------------------------------------------------
+
+uint8_t host__board__pulled_low(uint8_t port) {
+    uint8_t mask = 0;
+
+    for (uint8_t r = 0; r < OPT__KB__ROWS; r++) {
+        for (uint8_t c = 0; c < sizeof(columns)/sizeof(*columns); c++) {
+            if (!host__matrix__is_pressed(r, FIRST_COLUMN+c))
+                continue;
+
+            if (rows[r].port == port && driven_low(columns[c]))
+                mask |= 1<<rows[r].bit;
+            if (columns[c].port == port && driven_low(rows[r]))
+                mask |= 1<<columns[c].bit;
+        }
+    }
+
+    return mask;
+}
@@ -14,6 +14,7 @@
 #include <stdint.h>
 #include <util/twi.h>
 #include "../../../../firmware/keyboard.h"
+#include "../../../../firmware/lib/timer.h"
 #include "../../../../firmware/lib/twi.h"
 #include "./mcp23018.h"
 
@@ -50,23 +51,185 @@
  *   `OPT__MCP23018__DRIVE_ROWS` to `1`
  */
 
+#ifndef OPT__MCP23018__SKIP_IDLE_SCANS
+    #error "OPT__MCP23018__SKIP_IDLE_SCANS not defined"
+#endif
+/**                           macros/OPT__MCP23018__SKIP_IDLE_SCANS/description
+ * Whether to stop scanning the left half while none of its keys are pressed
+ *
+ * Notes:
+ * - When a scan finds no keys pressed, all the driving pins are set low, and
+ *   the MCP23018 is set to flag any input pin that goes low (i.e. any key
+ *   that's pressed).  Until it does, each scan only reads the flags (`INTFA`
+ *   and `INTFB`), instead of strobing every row or column.
+ * - The flags are read over TWI, since the MCP23018's `INTA` and `INTB` pins
+ *   aren't connected to the Teensy.
+ */
+
 // ----------------------------------------------------------------------------
 
 // register addresses (see "mcp23018.md")
 #define IODIRA 0x00  // i/o direction register
 #define IODIRB 0x01
+#define GPINTENA 0x04  // interrupt-on-change enable register
+#define GPINTENB 0x05
+#define DEFVALA  0x06  // default compare register for interrupt-on-change
+#define DEFVALB  0x07
+#define INTCONA  0x08  // interrupt control register
+#define INTCONB  0x09
+#define IOCON  0x0A  // i/o expander configuration register
 #define GPPUA  0x0C  // GPIO pull-up resistor register
 #define GPPUB  0x0D
+#define INTFA  0x0E  // interrupt flag register
+#define INTFB  0x0F
 #define GPIOA  0x12  // general purpose i/o port register (write modifies OLAT)
 #define GPIOB  0x13
 #define OLATA  0x14  // output latch register
 #define OLATB  0x15
 
+// IOCON bits (see "mcp23018.md")
+#define  SEQOP  5
+
 // TWI aliases
 #define  TWI_ADDR        0b0100000
 #define  TWI_ADDR_WRITE  ( (TWI_ADDR<<1) | TW_WRITE )
 #define  TWI_ADDR_READ   ( (TWI_ADDR<<1) | TW_READ  )
 
+// the matrix columns (bits of each row) handled by the MCP23018
+#define  MCP23018_COLUMNS  0b0000000001111111
+
+// the driving pins
+// - `DRIVE_PORT`: the register that sets them
+// - `DRIVE_IDLE`: the value that sets all of them low
+// - `STROBES`: how many there are
+// - `STROBE(n)`: the value that sets pin `n` low, and the others hi-Z
+// - `INPUT_PINS`: the input pins, in the other port
+#if OPT__MCP23018__DRIVE_ROWS
+    #define  DRIVE_PORT  GPIOB
+    #define  DRIVE_IDLE  0b11000000
+    #define  STROBES     6
+    #define  STROBE(n)   ( 0xFF & ~(1<<(5-(n))) )
+    #define  INPUT_PINS  0b01111111
+#elif OPT__MCP23018__DRIVE_COLUMNS
+    #define  DRIVE_PORT  GPIOA
+    #define  DRIVE_IDLE  0b10000000
+    #define  STROBES     7
+    #define  STROBE(n)   ( 0xFF & ~(1<<(n)) )
+    #define  INPUT_PINS  0b00111111
+#endif
+
+#if STROBES + 1 > TWI__QUEUE_LENGTH
+    #error "TWI__QUEUE_LENGTH is too short to queue a whole scan"
+#endif
+
+/**                                           macros/PROBE_INTERVAL/description
+ * How often to check whether the MCP23018 has been plugged in, while it isn't
+ * connected (in milliseconds)
+ */
+#define  PROBE_INTERVAL  100
+
+// ----------------------------------------------------------------------------
+
+/**                                                 variables/state/description
+ * The state of the connection to the MCP23018
+ *
+ * Struct members:
+ * - `connected`: Whether the MCP23018 has been initialized, and has responded
+ *   to everything since
+ * - `status`: The TWI status code of the last failure (while not connected)
+ * - `last_probe`: When we last tried to initialize the MCP23018 (in
+ *   milliseconds)
+ * - `idle`: Whether no keys were pressed during the last scan, and we're
+ *   waiting for the MCP23018 to flag a change (see
+ *   `OPT__MCP23018__SKIP_IDLE_SCANS`)
+ */
+static struct {
+    bool     connected;
+    bool     idle;
+    uint8_t  status;
+    uint16_t last_probe;
+} state;
+
+/**                                                  variables/scan/description
+ * The TWI transactions making up a scan, and their data
+ *
+ * Struct members:
+ * - `strobe`: For each driving pin: set it low (and the others hi-Z), then
+ *   read the input pins
+ * - `strobe_data`: The register address and value sent by each `strobe`
+ * - `read`: The value of the input pins read by each `strobe`
+ * - `release`: Set all the driving pins hi-Z
+ * - `arm`: Set all the driving pins low
+ * - `point`: Leave the register pointer at `INTFA`
+ * - `poll`: Read `INTFA` and `INTFB`
+ * - `intf`: The values read by `poll`
+ * - `last`: The last transaction of the scan in progress (`release`, or
+ *   `point`)
+ *
+ * Notes:
+ * - `arm`, `point`, and `poll` are only used if
+ *   `OPT__MCP23018__SKIP_IDLE_SCANS` is set.
+ * - `strobe` and `strobe_data` are set up by `mcp23018__init()`, and `last`
+ *   by `strobes_done()`.  Everything else is set up here.
+ */
+static struct {
+    struct twi__transaction strobe[STROBES];
+    uint8_t                 strobe_data[STROBES][2];
+    uint8_t                 read[STROBES];
+    struct twi__transaction release;
+    struct twi__transaction arm;
+    struct twi__transaction point;
+    struct twi__transaction poll;
+    uint8_t                 intf[2];
+    struct twi__transaction * last;
+} scan = {
+    .release = { .address = TWI_ADDR, .write_length = 2,
+                 .write = (uint8_t const []){ DRIVE_PORT, 0xFF } },
+    .arm     = { .address = TWI_ADDR, .write_length = 2,
+                 .write = (uint8_t const []){ DRIVE_PORT, DRIVE_IDLE } },
+    .point   = { .address = TWI_ADDR, .write_length = 1,
+                 .write = (uint8_t const []){ INTFA } },
+    .poll    = { .address = TWI_ADDR, .read_length = 2,
+                 .read = scan.intf },
+};
+
+// ----------------------------------------------------------------------------
+
+/**                                          functions/strobes_done/description
+ * Finish the scan: if no keys are pressed, set all driving pins low (so that
+ * any key pressed will pull its input low), and leave the register pointer at
+ * `INTFA` (see `OPT__MCP23018__SKIP_IDLE_SCANS`); otherwise, set them all
+ * hi-Z
+ *
+ * Notes:
+ * - The `done` function of the last strobe.  It runs (in the TWI interrupt)
+ *   before the bus is released, so the scan stays a single transaction,
+ *   whichever way it ends.
+ */
+static void strobes_done(struct twi__transaction * transaction) {
+    if (transaction->status) {
+        scan.last = transaction;  // error: the scan is over
+        return;
+    }
+
+    #if OPT__MCP23018__SKIP_IDLE_SCANS
+        state.idle = true;
+        for (uint8_t i=0; i<STROBES; i++)
+            if ((scan.read[i] & INPUT_PINS) != INPUT_PINS)
+                state.idle = false;
+
+        if (state.idle) {
+            twi__submit(&scan.arm);
+            twi__submit(&scan.point);
+            scan.last = &scan.point;
+            return;
+        }
+    #endif
+
+    twi__submit(&scan.release);
+    scan.last = &scan.release;
+}
+
 // ----------------------------------------------------------------------------
 
 /**                                        functions/mcp23018__init/description
@@ -79,10 +242,36 @@
  * Notes:
  * - `twi__stop()` must be called *exactly once* for each twi block, the way
  *   things are currently set up.  this may change in the future.
+ * - If the MCP23018 isn't there (the left half isn't plugged in), this fails
+ *   at the first byte, so it doubles as a cheap check for whether it's there
+ *   yet.
  */
 uint8_t mcp23018__init(void) {
     uint8_t ret;
 
+    // set up the scan transactions
+    for (uint8_t i=0; i<STROBES; i++) {
+        scan.strobe_data[i][0] = DRIVE_PORT;
+        scan.strobe_data[i][1] = STROBE(i);
+        scan.strobe[i] = (struct twi__transaction){
+            .address      = TWI_ADDR,
+            .write        = scan.strobe_data[i],
+            .write_length = 2,
+            .read         = &scan.read[i],
+            .read_length  = 1,
+        };
+    }
+    scan.strobe[STROBES-1].done = &strobes_done;
+
+    // set byte mode (with `BANK = 0`, the register pointer toggles between
+    // the A and B registers of a pair, instead of incrementing)
+    twi__start();
+    ret = twi__send(TWI_ADDR_WRITE);
+    if (ret) goto out;  // make sure we got an ACK
+    twi__send(IOCON);
+    twi__send(1<<SEQOP);
+    twi__stop();
+
     // set pin direction
     // - unused  : input  : 1
     // - input   : input  : 1
@@ -117,6 +306,58 @@ uint8_t mcp23018__init(void) {
     #endif
     twi__stop();
 
+    // set interrupt-on-change (see `OPT__MCP23018__SKIP_IDLE_SCANS`)
+    #if OPT__MCP23018__SKIP_IDLE_SCANS
+        // enable
+        // - unused  : off : 0
+        // - input   : on  : 1
+        // - driving : off : 0
+        twi__start();
+        ret = twi__send(TWI_ADDR_WRITE);
+        if (ret) goto out;  // make sure we got an ACK
+        twi__send(GPINTENA);
+        #if OPT__MCP23018__DRIVE_ROWS
+            twi__send(0b01111111);  // GPINTENA
+            twi__send(0b00000000);  // GPINTENB
+        #elif OPT__MCP23018__DRIVE_COLUMNS
+            twi__send(0b00000000);  // GPINTENA
+            twi__send(0b00111111);  // GPINTENB
+        #endif
+        twi__stop();
+
+        // set the value to compare against (doesn't matter where disabled)
+        // - all : high : 1
+        twi__start();
+        ret = twi__send(TWI_ADDR_WRITE);
+        if (ret) goto out;  // make sure we got an ACK
+        twi__send(DEFVALA);
+        #if OPT__MCP23018__DRIVE_ROWS
+            twi__send(0b11111111);  // DEFVALA
+            twi__send(0b11111111);  // DEFVALB
+        #elif OPT__MCP23018__DRIVE_COLUMNS
+            twi__send(0b11111111);  // DEFVALA
+            twi__send(0b11111111);  // DEFVALB
+        #endif
+        twi__stop();
+
+        // compare against `DEFVAL` (instead of against the previous value)
+        // - unused  : (doesn't matter) : 0
+        // - input   : `DEFVAL`         : 1
+        // - driving : (doesn't matter) : 0
+        twi__start();
+        ret = twi__send(TWI_ADDR_WRITE);
+        if (ret) goto out;  // make sure we got an ACK
+        twi__send(INTCONA);
+        #if OPT__MCP23018__DRIVE_ROWS
+            twi__send(0b01111111);  // INTCONA
+            twi__send(0b00000000);  // INTCONB
+        #elif OPT__MCP23018__DRIVE_COLUMNS
+            twi__send(0b00000000);  // INTCONA
+            twi__send(0b00111111);  // INTCONB
+        #endif
+        twi__stop();
+    #endif
+
     // set logical value (doesn't matter on inputs)
     // - unused  : hi-Z : 1
     // - input   : hi-Z : 1
@@ -130,6 +371,12 @@ uint8_t mcp23018__init(void) {
 
 out:
     twi__stop();
+
+    state.connected = !ret;
+    state.idle = false;
+    state.status = ret;
+    state.last_probe = timer__get_milliseconds();
+
     return ret;
 }
 
@@ -137,102 +384,110 @@ out:
  * Update the MCP23018 (left hand) half of the given matrix
  *
  * Arguments:
- * - `matrix`: A matrix of booleans, indicating whether the key at the given
- *   matrix location is pressed or released
+ * - `matrix`: A matrix of row bitmasks, with bit `n` of a row set if the key
+ *   in column `n` is pressed
  *
  * Returns:
  * - success: `0`
  * - failure: twi status code
+ *
+ * Notes:
+ * - While the MCP23018 isn't connected, our part of the matrix is cleared,
+ *   and we only try to initialize it (every `PROBE_INTERVAL` milliseconds).
+ *   Once it's connected, we go straight to scanning.  Any failure to respond
+ *   (e.g. because the left half was unplugged) disconnects it again.
+ * - While none of our keys are pressed, we only check whether any have been
+ *   (see `OPT__MCP23018__SKIP_IDLE_SCANS`).
+ * - If the bus hangs (e.g. because of a bad connection), the TWI library
+ *   recovers it, and we fail with `TWI__TIMEOUT`.  So a scan takes at most
+ *   about `TWI__TIMEOUT_US` longer than usual, and after that, we're
+ *   disconnected (and only probe the bus every `PROBE_INTERVAL`).
  */
-uint8_t mcp23018__update_matrix(bool matrix[OPT__KB__ROWS][OPT__KB__COLUMNS]) {
-    uint8_t ret, data;
-
-    // initialize things, just to make sure
-    // - it's not appreciably faster to skip this, and it takes care of the
-    //   case when the i/o expander isn't plugged in during the first
-    //   init()
-    ret = mcp23018__init();
-
-    // if there was an error
-    if (ret) {
-        // clear our part of the matrix
-        for (uint8_t row=0; row<=5; row++)
-            for (uint8_t col=0; col<=6; col++)
-                matrix[row][col] = 0;
+uint8_t mcp23018__update_matrix(uint16_t matrix[OPT__KB__ROWS]) {
+    uint8_t ret;
 
-        return ret;
+    // clear our part of the matrix
+    for (uint8_t row=0; row<=5; row++)
+        matrix[row] &= ~MCP23018_COLUMNS;
+
+    // if not connected, check (now and then) whether it's been plugged in
+    if (!state.connected) {
+        if ( (uint16_t)(timer__get_milliseconds() - state.last_probe)
+             < PROBE_INTERVAL )
+            return state.status;
+        if (( ret = mcp23018__init() ))
+            return ret;
     }
 
-    // update our part of the matrix ..........................................
+    // if nothing was pressed last time, just check whether anything's changed
+    // - the register pointer was left at `INTFA` (see `strobes_done()`).
+    //   reading both flag registers brings it back there.
+    #if OPT__MCP23018__SKIP_IDLE_SCANS
+        if (state.idle) {
+            twi__submit(&scan.poll);
+            if (( ret = twi__wait(&scan.poll) ))
+                goto out;
 
-    #if OPT__MCP23018__DRIVE_ROWS
-        for (uint8_t row=0; row<=5; row++) {
-            // set active row low  : 0
-            // set other rows hi-Z : 1
-            twi__start();
-            twi__send(TWI_ADDR_WRITE);
-            twi__send(GPIOB);
-            twi__send( 0xFF & ~(1<<(5-row)) );
-            twi__stop();
-
-            // read column data
-            twi__start();
-            twi__send(TWI_ADDR_WRITE);
-            twi__send(GPIOA);
-            twi__start();
-            twi__send(TWI_ADDR_READ);
-            twi__read(&data);
-            twi__stop();
-
-            // update matrix
-            for (uint8_t col=0; col<=6; col++) {
-                matrix[row][col] = !( data & (1<<col) );
-            }
+            if (!(scan.intf[0] | scan.intf[1]))
+                return 0;  // success (nothing pressed)
+
+            state.idle = false;
         }
+    #endif
 
-        // set all rows hi-Z : 1
-        twi__start();
-        twi__send(TWI_ADDR_WRITE);
-        twi__send(GPIOB);
-        twi__send(0xFF);
-        twi__stop();
+    // update our part of the matrix ..........................................
 
-    #elif OPT__MCP23018__DRIVE_COLUMNS
-        for (uint8_t col=0; col<=6; col++) {
-            // set active column low  : 0
-            // set other columns hi-Z : 1
-            twi__start();
-            twi__send(TWI_ADDR_WRITE);
-            twi__send(GPIOA);
-            twi__send( 0xFF & ~(1<<col) );
-            twi__stop();
-
-            // read row data
-            twi__start();
-            twi__send(TWI_ADDR_WRITE);
-            twi__send(GPIOB);
-            twi__start();
-            twi__send(TWI_ADDR_READ);
-            twi__read(&data);
-            twi__stop();
-
-            // update matrix
-            for (uint8_t row=0; row<=5; row++) {
-                matrix[row][col] = !( data & (1<<(5-row)) );
-            }
-        }
+    // - the whole scan is queued at once, and runs as one transaction: each
+    //   strobe is a register write followed by a repeated START and a one
+    //   byte read.  since the register pointer toggles within the A/B pair
+    //   (see `mcp23018__init()`), the read comes from the other port of the
+    //   pair, without our having to send its address.  the last strobe
+    //   queues the end of the scan (see `strobes_done()`).
+    // - the queue is empty here (we're the only ones using it, and we always
+    //   wait for it to finish), and long enough for a whole scan
+    // - the wait hook (if there is one) runs while we wait
+    // - if the bus hangs, the strobes fail without `strobes_done()` running,
+    //   so `last` must not be left over from an earlier scan (or unset)
+
+    scan.last = &scan.strobe[STROBES-1];
+    for (uint8_t i=0; i<STROBES; i++)
+        twi__submit(&scan.strobe[i]);
+    twi__wait(&scan.strobe[STROBES-1]);
+    twi__wait(scan.last);
+
+    for (uint8_t i=0; i<STROBES; i++)
+        if (( ret = scan.strobe[i].status ))
+            goto out;
+    if (state.idle && (( ret = scan.arm.status )))
+        goto out;
+    if (( ret = scan.last->status ))
+        goto out;
 
-        // set all columns hi-Z : 1
-        twi__start();
-        twi__send(TWI_ADDR_WRITE);
-        twi__send(GPIOA);
-        twi__send(0xFF);
-        twi__stop();
+    #if OPT__MCP23018__DRIVE_ROWS
+        for (uint8_t row=0; row<=5; row++)
+            matrix[row] |= ~scan.read[row] & MCP23018_COLUMNS;
+
+    #elif OPT__MCP23018__DRIVE_COLUMNS
+        for (uint8_t col=0; col<=6; col++)
+            for (uint8_t row=0; row<=5; row++)
+                if (!( scan.read[col] & (1<<(5-row)) ))
+                    matrix[row] |= 1<<col;
 
     #endif
 
     // /update our part of the matrix .........................................
 
-    return ret;  // success
+    return 0;  // success
+
+out:
+    // forget whatever we read, and go back to waiting for it to be plugged in
+    for (uint8_t row=0; row<=5; row++)
+        matrix[row] &= ~MCP23018_COLUMNS;
+
+    state.connected = false;
+    state.idle = false;
+    state.status = ret;
+
+    return ret;
 }
 
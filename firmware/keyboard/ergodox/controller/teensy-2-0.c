@@ -104,24 +104,36 @@
 #define  COLUMN_C  D, 3
 #define  COLUMN_D  C, 6
 
+// the matrix columns (bits of each row) handled by the Teensy
+#define  TEENSY_COLUMNS  0b0011111110000000
+
 // --- helpers
 #define  SET    |=
 #define  CLEAR  &=~
 
 #define  _teensypin_write(register, operation, pin_letter, pin_number)  \
-    do {                                                                \
-        ((register##pin_letter) operation (1<<(pin_number)));           \
-        _delay_us(1);  /* allow pins time to stabilize */               \
-    } while(0)
+    ((register##pin_letter) operation (1<<(pin_number)))
 
 #define  teensypin_write(register, operation, pin)  \
         _teensypin_write(register, operation, pin)
 
-#define  _teensypin_read(pin_letter, pin_number)    \
-    ((PIN##pin_letter) & (1<<(pin_number)))
+/*
+ * read helpers
+ * - `teensypins_read()` takes a snapshot of all the input registers at once;
+ *   `teensypin_is_low()` picks a pin out of the snapshot.  since the pin
+ *   macros are constant, each use of `teensypin_is_low()` compiles down to a
+ *   fixed shift and mask: the permutation from port bits to matrix bits is
+ *   worked out at compile time.
+ */
+#define  teensypins_read(pins)                                          \
+    struct { uint8_t B, C, D, E, F; } pins =                            \
+        { ~PINB, ~PINC, ~PIND, ~PINE, ~PINF }  /* (inverted: low = 1) */
+
+#define  _teensypin_is_low(pins, pin_letter, pin_number)    \
+    ( (uint16_t)((pins).pin_letter >> (pin_number)) & 1 )
 
-#define  teensypin_read(pin)    \
-        _teensypin_read(pin)
+#define  teensypin_is_low(pins, pin)    \
+        _teensypin_is_low(pins, pin)
 
 #define  teensypin_write_all_unused(register, operation)    \
     do {                                                    \
@@ -156,36 +168,51 @@
 
 /*
  * update macros
+ * - the strobe is driven, we wait (once) for the pins to settle, then read
+ *   every input at once.  releasing the strobe needs no delay of its own:
+ *   the pins it pulled low recover during the next strobe's delay (or before
+ *   the next scan).
  */
-#define  update_rows_for_column(matrix, column)             \
-    do {                                                    \
-        /* set column low (set as output) */                \
-        teensypin_write(DDR, SET, COLUMN_##column);         \
-        /* read rows 0..5 and update matrix */              \
-        matrix[0x0][0x##column] = ! teensypin_read(ROW_0);  \
-        matrix[0x1][0x##column] = ! teensypin_read(ROW_1);  \
-        matrix[0x2][0x##column] = ! teensypin_read(ROW_2);  \
-        matrix[0x3][0x##column] = ! teensypin_read(ROW_3);  \
-        matrix[0x4][0x##column] = ! teensypin_read(ROW_4);  \
-        matrix[0x5][0x##column] = ! teensypin_read(ROW_5);  \
-        /* set column hi-Z (set as input) */                \
-        teensypin_write(DDR, CLEAR, COLUMN_##column);       \
+#define  update_rows_for_column(matrix, column)                         \
+    do {                                                                \
+        /* set column low (set as output) */                            \
+        teensypin_write(DDR, SET, COLUMN_##column);                     \
+        _delay_us(1);  /* allow pins time to stabilize */               \
+        /* read rows 0..5 */                                            \
+        teensypins_read(pins);                                          \
+        /* set column hi-Z (set as input) */                            \
+        teensypin_write(DDR, CLEAR, COLUMN_##column);                   \
+        /* update our column of the matrix */                           \
+        update_row_bit(matrix, pins, 0, column);                        \
+        update_row_bit(matrix, pins, 1, column);                        \
+        update_row_bit(matrix, pins, 2, column);                        \
+        update_row_bit(matrix, pins, 3, column);                        \
+        update_row_bit(matrix, pins, 4, column);                        \
+        update_row_bit(matrix, pins, 5, column);                        \
     } while(0)
 
-#define  update_columns_for_row(matrix, row)                \
-    do {                                                    \
-        /* set row low (set as output) */                   \
-        teensypin_write(DDR, SET, ROW_##row);               \
-        /* read columns 7..D and update matrix */           \
-        matrix[0x##row][0x7] = ! teensypin_read(COLUMN_7);  \
-        matrix[0x##row][0x8] = ! teensypin_read(COLUMN_8);  \
-        matrix[0x##row][0x9] = ! teensypin_read(COLUMN_9);  \
-        matrix[0x##row][0xA] = ! teensypin_read(COLUMN_A);  \
-        matrix[0x##row][0xB] = ! teensypin_read(COLUMN_B);  \
-        matrix[0x##row][0xC] = ! teensypin_read(COLUMN_C);  \
-        matrix[0x##row][0xD] = ! teensypin_read(COLUMN_D);  \
-        /* set row hi-Z (set as input) */                   \
-        teensypin_write(DDR, CLEAR, ROW_##row);             \
+#define  update_row_bit(matrix, pins, row, column)                      \
+    ( matrix[0x##row] = ( matrix[0x##row] & ~(1 << 0x##column) )        \
+                        | teensypin_is_low(pins, ROW_##row) << 0x##column )
+
+#define  update_columns_for_row(matrix, row)                            \
+    do {                                                                \
+        /* set row low (set as output) */                               \
+        teensypin_write(DDR, SET, ROW_##row);                           \
+        _delay_us(1);  /* allow pins time to stabilize */               \
+        /* read columns 7..D */                                         \
+        teensypins_read(pins);                                          \
+        /* set row hi-Z (set as input) */                               \
+        teensypin_write(DDR, CLEAR, ROW_##row);                         \
+        /* update our part of the row */                                \
+        matrix[0x##row] = ( matrix[0x##row] & ~TEENSY_COLUMNS )         \
+                          | teensypin_is_low(pins, COLUMN_7) << 0x7     \
+                          | teensypin_is_low(pins, COLUMN_8) << 0x8     \
+                          | teensypin_is_low(pins, COLUMN_9) << 0x9     \
+                          | teensypin_is_low(pins, COLUMN_A) << 0xA     \
+                          | teensypin_is_low(pins, COLUMN_B) << 0xB     \
+                          | teensypin_is_low(pins, COLUMN_C) << 0xC     \
+                          | teensypin_is_low(pins, COLUMN_D) << 0xD;    \
     } while(0)
 
 // ----------------------------------------------------------------------------
@@ -239,29 +266,57 @@ uint8_t teensy__init(void) {
  * Update the Teensy (right hand) half of the given matrix
  *
  * Arguments:
- * - `matrix`: A matrix of booleans, indicating whether the key at the given
- *   matrix location is pressed or released
+ * - `matrix`: A matrix of row bitmasks, with bit `n` of a row set if the key
+ *   in column `n` is pressed
  *
  * Returns:
  * - success: `0`
  */
-uint8_t teensy__update_matrix(bool matrix[OPT__KB__ROWS][OPT__KB__COLUMNS]) {
+uint8_t teensy__update_matrix(uint16_t matrix[OPT__KB__ROWS]) {
+    for (uint8_t strobe=0; strobe<TEENSY__STROBES; strobe++)
+        teensy__strobe(matrix, strobe);
+
+    return 0;  // success
+}
+
+/**                                        functions/teensy__strobe/description
+ * Update the part of the Teensy half of the given matrix covered by one strobe
+ * (one driven column, or one driven row, depending on the pin drive direction)
+ *
+ * Arguments:
+ * - `matrix`: A matrix of row bitmasks, with bit `n` of a row set if the key
+ *   in column `n` is pressed
+ * - `strobe`: Which strobe to perform (`0` to `TEENSY__STROBES - 1`)
+ *
+ * Returns:
+ * - success: `0`
+ * - failure: `1` (if `strobe` is out of range)
+ *
+ * Notes:
+ * - Strobes are independent of each other (each clears its own part of the
+ *   matrix before updating it), so they may be performed one at a time, in
+ *   between other work (see "../controller.c").
+ */
+uint8_t teensy__strobe(uint16_t matrix[OPT__KB__ROWS], uint8_t strobe) {
+    switch (strobe) {
     #if OPT__TEENSY__DRIVE_ROWS
-        update_columns_for_row(matrix, 0);
-        update_columns_for_row(matrix, 1);
-        update_columns_for_row(matrix, 2);
-        update_columns_for_row(matrix, 3);
-        update_columns_for_row(matrix, 4);
-        update_columns_for_row(matrix, 5);
+        case 0: update_columns_for_row(matrix, 0); break;
+        case 1: update_columns_for_row(matrix, 1); break;
+        case 2: update_columns_for_row(matrix, 2); break;
+        case 3: update_columns_for_row(matrix, 3); break;
+        case 4: update_columns_for_row(matrix, 4); break;
+        case 5: update_columns_for_row(matrix, 5); break;
     #elif OPT__TEENSY__DRIVE_COLUMNS
-        update_rows_for_column(matrix, 7);
-        update_rows_for_column(matrix, 8);
-        update_rows_for_column(matrix, 9);
-        update_rows_for_column(matrix, A);
-        update_rows_for_column(matrix, B);
-        update_rows_for_column(matrix, C);
-        update_rows_for_column(matrix, D);
+        case 0: update_rows_for_column(matrix, 7); break;
+        case 1: update_rows_for_column(matrix, 8); break;
+        case 2: update_rows_for_column(matrix, 9); break;
+        case 3: update_rows_for_column(matrix, A); break;
+        case 4: update_rows_for_column(matrix, B); break;
+        case 5: update_rows_for_column(matrix, C); break;
+        case 6: update_rows_for_column(matrix, D); break;
     #endif
+        default: return 1;  // error: no such strobe
+    }
 
     return 0;  // success
 }
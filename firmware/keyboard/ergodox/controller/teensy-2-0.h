@@ -21,11 +21,37 @@
 
 // ----------------------------------------------------------------------------
 
+#if OPT__TEENSY__DRIVE_ROWS
+    #define  TEENSY__STROBES  6
+#elif OPT__TEENSY__DRIVE_COLUMNS
+    #define  TEENSY__STROBES  7
+#endif
+
+// ----------------------------------------------------------------------------
+
 uint8_t teensy__init          (void);
-uint8_t teensy__update_matrix (bool matrix[OPT__KB__ROWS][OPT__KB__COLUMNS]);
+uint8_t teensy__update_matrix (uint16_t matrix[OPT__KB__ROWS]);
+uint8_t teensy__strobe        (uint16_t matrix[OPT__KB__ROWS], uint8_t strobe);
 
 
 // ----------------------------------------------------------------------------
 // ----------------------------------------------------------------------------
 #endif  // ERGODOX_FIRMWARE__FIRMWARE__KEYBOARD__ERGODOX__CONTROLLER__TEENSY_2_0__H
 
+
+
+// ============================================================================
+// === documentation ==========================================================
+// ============================================================================
+
+
+// ----------------------------------------------------------------------------
+// macros ---------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+// === TEENSY__STROBES ===
+/**                                          macros/TEENSY__STROBES/description
+ * The number of strobes (driven pins) it takes to scan the Teensy half of the
+ * matrix
+ */
+
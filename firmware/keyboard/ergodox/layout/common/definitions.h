@@ -23,6 +23,7 @@
 #include "../../../../../firmware/lib/timer.h"
 #include "../../../../../firmware/lib/usb.h"
 #include "../../../../../firmware/lib/usb/usage-page/keyboard.h"
+#include "../../../../../firmware/lib/layout/eeprom-layout.h"
 #include "../../../../../firmware/lib/layout/key-functions.h"
 #include "../../../../../firmware/lib/layout/mouse.h"
 #include "../../../../../firmware/lib/layout/layer-stack.h"
@@ -41,9 +42,10 @@
 #define  R(name)  keys__release__##name
 
 /**                                                        macros/K/description
- * Expand into a "key" suitable for putting into the layout matrix
+ * Expand `name` into the corresponding action word, suitable for putting into
+ * the layout matrix
  */
-#define  K(name)  { &keys__press__##name, &keys__release__##name }
+#define  K(name)  keys__action__##name
 
 /**                                                       macros/KF/description
  * Expand `name` into the corresponding "key_functions" function name
@@ -51,46 +53,221 @@
 #define  KF(name)  key_functions__##name
 
 // ----------------------------------------------------------------------------
-// special meaning keys (may be used by `exec_key()`)
+// actions
 
-/**                                                     keys/transp/description
- * transparent
+/**                                            macros/(group) kinds/description
+ * The kinds of action word (kept in the top 4 bits of the word)
  *
- * This key signals to the firmware (specifically the
- * `kb__layout__exec_key_location()` function) that it should look for what key
- * to "press" or "release" by going down the layer-stack until it finds a
- * non-transparent key at the same position.
+ * Members:
+ * - `ACTION__KIND__NONE`: Do nothing (see `ACTION__TRANSP` and `ACTION__NOP`)
+ * - `ACTION__KIND__KEY`: Press (and release) a keycode, along with any of
+ *   the left modifiers (see `ACTION__KEY()`)
+ * - `ACTION__KIND__LAYER`: Push, pop, or reset layers (see `ACTION__LAYER()`)
+ * - `ACTION__KIND__MOUSE`: Press (and release) mouse buttons (see
+ *   `ACTION__MOUSE()`)
+ * - `ACTION__KIND__SPECIAL`: Do something that doesn't fit any other kind
+ *   (see `ACTION__SPECIAL()`)
+ * - `ACTION__KIND__TAP_MOD`: Send a keycode when tapped, or hold down
+ *   modifiers when held (see `ACTION__TAP_MOD()`)
+ * - `ACTION__KIND__TAP_LAYER`: Send a keycode when tapped, or push a layer
+ *   when held (see `ACTION__TAP_LAYER()`)
+ * - `ACTION__KIND__FUNCTION`: Call a pair of functions (see
+ *   `ACTION__FUNCTION()`)
  *
  * Notes:
- * - With this scheme, keys may be half transparent; that is, the "press" part
- *   of a key may be transparent while the "release" part isn't, or vice versa.
- *   I expect this to be fairly uncommon though.
+ * - Kinds must be less than `8`, so that action words fit in an `int`
+ *   (which is 16 bits on the AVR), and may be `enum` constants.
+ */
+#define  ACTION__KIND__NONE       0
+#define  ACTION__KIND__KEY        1
+#define  ACTION__KIND__LAYER      2
+#define  ACTION__KIND__MOUSE      3
+#define  ACTION__KIND__SPECIAL    4
+#define  ACTION__KIND__TAP_MOD    5
+#define  ACTION__KIND__TAP_LAYER  6
+#define  ACTION__KIND__FUNCTION   7
+
+/**                                           macros/ACTION__TRANSP/description
+ * The action word for a transparent key
+ *
+ * This signals to `kb__layout__exec_key()` that it should look for what to do
+ * by going down the layer-stack until it finds a non-transparent key at the
+ * same position.
+ */
+#define  ACTION__TRANSP  0x0000
+
+/**                                              macros/ACTION__NOP/description
+ * The action word for a key that does nothing (and is not transparent)
+ */
+#define  ACTION__NOP  0x0001
+
+/**                                              macros/ACTION__KEY/description
+ * Return the action word for a key that presses `keycode`, with the given
+ * modifiers held down
+ *
+ * Arguments:
+ * - `modifiers`: A combination of the `ACTION__MOD__...` flags (`0` for
+ *   none).  Modifiers are pressed before the keycode, and released after it.
+ * - `keycode`: The keycode (`0` for none, if only modifiers are wanted)
+ */
+#define  ACTION__KEY(modifiers, keycode)  \
+    ( ACTION__KIND__KEY<<12 | (modifiers)<<8 | (keycode) )
+
+#define  ACTION__MOD__CTRL   (1<<0)  // (bit `n` is keycode `LeftControl + n`)
+#define  ACTION__MOD__SHIFT  (1<<1)
+#define  ACTION__MOD__ALT    (1<<2)
+#define  ACTION__MOD__GUI    (1<<3)
+
+/**                                            macros/ACTION__LAYER/description
+ * Return the action word for a layer key
+ *
+ * Arguments:
+ * - `operation`: One of the `ACTION__LAYER__...` operations below, optionally
+ *   combined with `ACTION__LAYER__NUMLOCK`
+ *     - `ACTION__LAYER__PUSH_POP`: Push the layer on press, and pop it on
+ *       release
+ *     - `ACTION__LAYER__PUSH`: Push the layer on press
+ *     - `ACTION__LAYER__POP`: Pop the layer on press
+ *     - `ACTION__LAYER__RESET`: Reset the layer-stack on press (`id` and
+ *       `number` are ignored)
+ *     - `ACTION__LAYER__NUMLOCK`: Also press "numlock" (or, with
+ *       `ACTION__LAYER__PUSH_POP`, tap it on both press and release), for
+ *       number pad layers
+ * - `id`: The layer-id (`0` to `31`)
+ * - `number`: The layer-number (`0` to `15`)
+ */
+#define  ACTION__LAYER(operation, id, number)  \
+    ( ACTION__KIND__LAYER<<12 | (operation)<<9 | (id)<<4 | (number) )
+
+#define  ACTION__LAYER__PUSH_POP  0
+#define  ACTION__LAYER__PUSH      1
+#define  ACTION__LAYER__POP       2
+#define  ACTION__LAYER__RESET     3
+#define  ACTION__LAYER__NUMLOCK   4
+
+/**                                            macros/ACTION__MOUSE/description
+ * Return the action word for a key that holds down the given mouse buttons
+ *
+ * Arguments:
+ * - `left`, `middle`, `right`: Whether to hold down each button (`0` or `1`)
  */
-void KF(transp) (void) {}
-#define  keys__press__transp    KF(transp)
-#define  keys__release__transp  KF(transp)
+#define  ACTION__MOUSE(left, middle, right)  \
+    ( ACTION__KIND__MOUSE<<12 | (left)<<0 | (middle)<<1 | (right)<<2 )
 
+/**                                          macros/ACTION__SPECIAL/description
+ * Return the action word for a key that does one of the things below, on
+ * press
+ *
+ * Arguments:
+ * - `which`: One of
+ *     - `ACTION__SPECIAL__BOOTLOADER`: `KF(jump_to_bootloader)()`
+ *     - `ACTION__SPECIAL__TOGGLE_NKRO`: `KF(toggle_nkro)()`
+ */
+#define  ACTION__SPECIAL(which)  ( ACTION__KIND__SPECIAL<<12 | (which) )
+
+#define  ACTION__SPECIAL__BOOTLOADER   0
+#define  ACTION__SPECIAL__TOGGLE_NKRO  1
+
+/**                                          macros/ACTION__TAP_MOD/description
+ * Return the action word for a tap-hold key that sends `keycode` when tapped,
+ * and holds down the given modifiers when held
+ *
+ * Arguments:
+ * - `modifiers`: A combination of the `ACTION__MOD__...` flags
+ * - `keycode`: The keycode
+ *
+ * Notes:
+ * - See ".../common/exec_key.c.h" for how taps are told from holds.
+ */
+#define  ACTION__TAP_MOD(modifiers, keycode)  \
+    ( ACTION__KIND__TAP_MOD<<12 | (modifiers)<<8 | (keycode) )
+
+/**                                        macros/ACTION__TAP_LAYER/description
+ * Return the action word for a tap-hold key that sends `keycode` when tapped,
+ * and pushes the given layer (popping it on release) when held
+ *
+ * Arguments:
+ * - `number`: The layer-number (`0` to `15`)
+ * - `keycode`: The keycode
+ *
+ * Notes:
+ * - See ".../common/exec_key.c.h" for how taps are told from holds.
+ */
+#define  ACTION__TAP_LAYER(number, keycode)  \
+    ( ACTION__KIND__TAP_LAYER<<12 | (number)<<8 | (keycode) )
+
+/**                                         macros/ACTION__FUNCTION/description
+ * Return the action word for a key that calls the `index`th pair of
+ * functions in `_functions`
+ *
+ * Notes:
+ * - This is the escape hatch, for keys that don't fit any other kind of
+ *   action.  See ".../common/keys.c.h" for how keys of this kind are defined.
+ */
+#define  ACTION__FUNCTION(index)  ( ACTION__KIND__FUNCTION<<12 | (index) )
+
+/**                                              macros/COMBO__KEYS/description
+ * The most keys a combo may have
+ */
+#define  COMBO__KEYS  6
+
+/**                                               macros/COMBO__ROW/description
+ * Return row `row` of the matrix bitmask covering the given key positions
+ *
+ * Arguments:
+ * - `row`: The row-number
+ * - `k1` ... `k6`: Key positions, as `0x<row><column>` (e.g. `0x2A` is row
+ *   `2`, column `10`; the same as the `k..` names in ".../common/matrix.h"),
+ *   or `0xFF` for none
+ */
+#define  COMBO__ROW(row, k1, k2, k3, k4, k5, k6)                       \
+    ( COMBO__BIT(row, k1) | COMBO__BIT(row, k2) | COMBO__BIT(row, k3)  \
+    | COMBO__BIT(row, k4) | COMBO__BIT(row, k5) | COMBO__BIT(row, k6) )
+
+#define  COMBO__BIT(row, key)  \
+    ( (key) >> 4 == (row) ? (uint16_t)1 << ((key) & 0xF) : 0 )
+
+// ----------------------------------------------------------------------------
+// special meaning keys (may be used by `exec_key()`)
+
+/**                                                     keys/transp/description
+ * transparent (see `ACTION__TRANSP`)
+ */
 /**                                                        keys/nop/desctiption
- * no operation
+ * no operation (see `ACTION__NOP`)
+ */
+enum {
+    keys__action__transp = ACTION__TRANSP,
+    keys__action__nop    = ACTION__NOP,
+};
+
+/**                                               functions/KF(nop)/description
+ * Do nothing
  *
- * This key does nothing (and is not transparent).
+ * Meant for keys defined as pairs of functions (see `ACTION__FUNCTION()`),
+ * which only need to do something on press, or on release.
  */
 void KF(nop) (void) {}
-#define  keys__press__nop    KF(nop)
-#define  keys__release__nop  KF(nop)
 
 // ----------------------------------------------------------------------------
 
+/**                                                 types/_action_t/description
+ * The type we will use for our "action words"
+ *
+ * Notes:
+ * - An action word holds its kind in the top 4 bits, and what to do in the
+ *   rest (see the `ACTION__...` macros)
+ * - Each key of each layer is one action word, which `...exec_key()`
+ *   interprets when the key is pressed or released
+ */
+typedef  uint16_t _action_t;
+
 /**                                                    types/_key_t/description
- * The type we will use for our "key"s
+ * The type we will use for keys defined as a pair of functions
  *
  * Notes:
  * - Keys will be of the form
  *   `_key_t key = { &press_function, &release_function };`
- *
- * - The fact that keys are of this type (composed of two
- *   `void (*function)(void)` pointers) is assumed throughout most of these
- *   layout files
  */
 typedef  void (*_key_t[2])(void);
 
@@ -101,7 +278,34 @@ typedef  void (*_key_t[2])(void);
  * - The first dimension of the matrix (left blank in the typedef since it
  *   varies between layouts) is "layers"
  */
-typedef  const _key_t _layout_t[][OPT__KB__ROWS][OPT__KB__COLUMNS];
+typedef  const _action_t _layout_t[][OPT__KB__ROWS][OPT__KB__COLUMNS];
+
+/**                                              types/_functions_t/description
+ * The type we will use for the table of keys defined as pairs of functions
+ */
+typedef  const _key_t _functions_t[];
+
+/**                                                  types/_combo_t/description
+ * The type we will use for combos (keys that are pressed together to do
+ * something other than what they'd each do alone)
+ *
+ * Struct members:
+ * - `keys`: The keys of the combo, as a matrix bitmask (bit `column` of
+ *   `keys[row]` is set for each key; the same format as `main__is_pressed`)
+ * - `action`: The action word to run when they're pressed together
+ */
+typedef  struct {
+    uint16_t  keys[OPT__KB__ROWS];
+    _action_t action;
+} _combo_t;
+
+/**                                                 types/_combos_t/description
+ * The type we will use for the table of combos
+ *
+ * Notes:
+ * - The table ends with an element whose `action` is `ACTION__TRANSP`.
+ */
+typedef  const _combo_t _combos_t[];
 
 // ----------------------------------------------------------------------------
 
@@ -110,6 +314,17 @@ typedef  const _key_t _layout_t[][OPT__KB__ROWS][OPT__KB__COLUMNS];
  */
 static _layout_t _layout PROGMEM;
 
+/**                                            variables/_functions/description
+ * The variable containing the keys that are defined as pairs of functions,
+ * indexed by `ACTION__FUNCTION()` action words (see ".../common/keys.c.h")
+ */
+static _functions_t _functions PROGMEM;
+
+/**                                               variables/_combos/description
+ * The variable containing the combos (see ".../common/keys.c.h")
+ */
+static _combos_t _combos PROGMEM;
+
 /**                                                variables/_flags/description
  * A collection of flags pertaining to the operation of `...exec_key()`
  *
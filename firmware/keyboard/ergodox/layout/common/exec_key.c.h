@@ -8,6 +8,50 @@
  * A default way to execute keys.
  *
  * Meant to be included *only* by the layout using it.
+ *
+ * Notes:
+ * - Each key of each layer is an action word (see ".../common/definitions.h"),
+ *   which is interpreted here.
+ * - Which layer each key resolves to (the highest layer in the layer-stack
+ *   where it isn't transparent) is kept in a table in SRAM, so executing a
+ *   key costs the same however deep the layer-stack is, and however many
+ *   transparent keys there are.  When the layer-stack changes, the whole
+ *   table is marked out of date, and each key is worked out again the next
+ *   time it's used (so a layer change costs little, and only keys that are
+ *   actually pressed on the new layers pay for a lookup through the stack).
+ *   The same happens when the EEPROM layout changes.
+ * - Keys on the lowest layers may be overridden by an EEPROM layout (see
+ *   ".../firmware/lib/layout/eeprom-layout.h").
+ *
+ * Tap-hold keys:
+ * - When a tap-hold key is pressed, nothing is sent until we've decided
+ *   whether it's being tapped or held.  It's a tap if it's released within
+ *   `OPT__TAP_HOLD__TERM` milliseconds, and a hold otherwise; unless
+ *   `OPT__TAP_HOLD__HOLD_ON_OTHER_KEY_PRESS` or
+ *   `OPT__TAP_HOLD__PERMISSIVE_HOLD` decides it's a hold sooner.
+ * - Only events that happen while a decision is pending are held back (and
+ *   then executed, in order, as soon as the decision is made).  Releases of
+ *   keys pressed before the tap-hold key aren't held back either, since they
+ *   can't affect the decision.  Everything else goes straight through.
+ *
+ * Combos:
+ * - Combos are matched before anything else.  The keys that are part of any
+ *   combo are kept as a matrix bitmask (`combo.used`), so events on other
+ *   keys cost a single bit test, and go straight through.
+ * - When a combo key is pressed, it's held back, along with any other combo
+ *   keys pressed within `OPT__COMBO__TERM` milliseconds of it.  The keys
+ *   held back are kept as a matrix bitmask too.  On each press, combos
+ *   without the key just pressed are skipped after reading one word of their
+ *   bitmask, and the rest are compared a row (`uint16_t`) at a time.  As soon
+ *   as no combo with more keys can still match (or the time runs out, or
+ *   some other key is pressed, or one of the keys held back is released),
+ *   the combo the keys match is run, if there is one; or else, the keys held
+ *   back are pressed, in order.  Releases of keys that aren't held back go
+ *   straight through, and the wait goes on.
+ * - A combo's action word is released when the first of its keys is, and the
+ *   releases of the rest are ignored.  Only one combo is down at a time: if
+ *   another is run first, the first is released, and the releases of all its
+ *   keys are ignored.
  */
 
 
@@ -21,64 +65,729 @@
 
 // ----------------------------------------------------------------------------
 
-void kb__layout__exec_key(bool pressed, uint8_t row, uint8_t column) {
+/**                                                 macros/NO_LAYER/description
+ * The value of an element of `resolved.layer` for a key that's transparent
+ * all the way down (through layer 0)
+ */
+#define  NO_LAYER  UINT8_MAX
 
-    // if we press a key, we need to keep track of the layer it was pressed on,
-    // so we can release it on the same layer
-    // - if the release is transparent, search through the layer stack for a
-    //   non-transparent release in the same position, as normal
-    // - don't need to initialize, since we'll only read from positions that
-    //   we've previously set
-    static uint8_t pressed_layer[OPT__KB__ROWS][OPT__KB__COLUMNS];
+/**                                             macros/TAP_LAYER_ID/description
+ * The layer-id a tap-hold key pushes the given layer-number with
+ *
+ * Notes:
+ * - `ACTION__LAYER()` action words only hold layer-ids up to `31`, so these
+ *   won't collide with theirs.
+ */
+#define  TAP_LAYER_ID(number)  ( 32 + (number) )
 
-    void (*function)(void);
-    uint8_t layer;
+/**                                      macros/OPT__TAP_HOLD__TERM/description
+ * How long a tap-hold key must be held (in milliseconds) before it counts as
+ * held
+ */
+#ifndef OPT__TAP_HOLD__TERM
+    #error "OPT__TAP_HOLD__TERM not defined"
+#endif
 
-    // - add 1 to the stack size because we spend the first iteration checking
-    //   to see if we need to release on a previously stored layer
-    // - add 1 to the stack size in order to peek out of bounds on the last
-    //   iteration (if we get that far), so that layer 0 is our default (see
-    //   the documentation for ".../firmware/lib/layout/layer-stack.h")
-    for (uint8_t i=0; i < layer_stack__size()+1+1; i++) {  // i = offset+1
-        if (i == 0)
-            if (!pressed)
-                layer = pressed_layer[row][column];
+/**                           macros/OPT__TAP_HOLD__PERMISSIVE_HOLD/description
+ * Whether a tap-hold key counts as held as soon as another key is pressed
+ * and released while it's down (`1`), or not (`0`)
+ */
+#ifndef OPT__TAP_HOLD__PERMISSIVE_HOLD
+    #error "OPT__TAP_HOLD__PERMISSIVE_HOLD not defined"
+#endif
+
+/**                   macros/OPT__TAP_HOLD__HOLD_ON_OTHER_KEY_PRESS/description
+ * Whether a tap-hold key counts as held as soon as another key is pressed
+ * while it's down (`1`), or not (`0`)
+ */
+#ifndef OPT__TAP_HOLD__HOLD_ON_OTHER_KEY_PRESS
+    #error "OPT__TAP_HOLD__HOLD_ON_OTHER_KEY_PRESS not defined"
+#endif
+
+/**                                         macros/OPT__COMBO__TERM/description
+ * How long (in milliseconds) after the first key of a combo is pressed the
+ * rest may be pressed
+ */
+#ifndef OPT__COMBO__TERM
+    #error "OPT__COMBO__TERM not defined"
+#endif
+
+/**                                    macros/OPT__TAP_HOLD__BUFFER/description
+ * The most key events that may be held back while a decision is pending
+ *
+ * Notes:
+ * - If more happen than this, the tap-hold key counts as held.
+ */
+#ifndef OPT__TAP_HOLD__BUFFER
+    #error "OPT__TAP_HOLD__BUFFER not defined"
+#endif
+
+// ----------------------------------------------------------------------------
+
+/**                                                     types/event/description
+ * A key event
+ *
+ * Struct members:
+ * - `pressed`: Whether the key was pressed (`true`) or released (`false`)
+ * - `row`, `column`: The position of the key
+ */
+struct event {
+    bool    pressed;
+    uint8_t row;
+    uint8_t column;
+};
+
+// ----------------------------------------------------------------------------
+
+/**                                              variables/resolved/description
+ * To hold the layer each key resolves to, given the current layer-stack
+ *
+ * Struct members:
+ * - `layer`: The layer-number the key's action word will be found on,
+ *   indexed by `[row][column]` (`NO_LAYER` if there isn't one)
+ * - `valid`: Which elements of `layer` are up to date (bit `column` of
+ *   `valid[row]` is set if `layer[row][column]` is)
+ * - `changes`: The value of `layer_stack__changes()` when `valid` was last
+ *   cleared
+ * - `eeprom_changes`: The value of `eeprom_layout__changes()` when `valid`
+ *   was last cleared
+ *
+ * Notes:
+ * - `changes` is only checked when a key is executed, so this would be
+ *   fooled if the layer-stack changed exactly a multiple of 256 times between
+ *   two key events.  Layers only change when keys are executed (or a few
+ *   times, by events they schedule), so this won't happen.  The EEPROM
+ *   layout changes far less often than that.
+ */
+static struct {
+    uint8_t  layer[OPT__KB__ROWS][OPT__KB__COLUMNS];
+    uint16_t valid[OPT__KB__ROWS];
+    uint8_t  changes;
+    uint8_t  eeprom_changes;
+} resolved;
+
+/**                                              variables/tap_hold/description
+ * The state of the tap-hold decision in progress
+ *
+ * Struct members:
+ * - `pending`: Whether a decision is in progress
+ * - `row`, `column`: The position of the tap-hold key
+ * - `action`: Its action word
+ * - `timer`: The handle of the event that will decide it's a hold (see
+ *   `expire()`)
+ * - `length`: The number of elements in `buffer`
+ * - `buffer`: The key events that have happened since it was pressed, to be
+ *   executed once the decision is made
+ */
+static struct {
+    bool            pending;
+    uint8_t         row;
+    uint8_t         column;
+    _action_t       action;
+    timer__handle_t timer;
+    uint8_t         length;
+    struct event    buffer[OPT__TAP_HOLD__BUFFER];
+} tap_hold;
+
+/**                                                 variables/combo/description
+ * The state of combo matching
+ *
+ * Struct members:
+ * - `used`: The keys that are part of any combo, as a matrix bitmask
+ * - `used_valid`: Whether `used` (and `count`) have been worked out yet
+ * - `count`: The number of combos in `_combos`
+ * - `pending`: Whether keys are being held back
+ * - `keys`: The keys held back, as a matrix bitmask
+ * - `length`: The number of elements in `buffer`
+ * - `buffer`: The positions of the keys held back (as `row << 4 | column`),
+ *   in the order they were pressed
+ * - `timer`: The handle of the event that will stop waiting for more keys
+ *   (see `lapse()`)
+ * - `match`: The action word of the combo that `keys` matches exactly
+ *   (`ACTION__TRANSP` if none)
+ * - `action`: The action word of the combo that was last run, until it's
+ *   released (`ACTION__TRANSP` if none)
+ * - `active`: The keys whose releases are to be ignored, since they were
+ *   part of a combo that was run, as a matrix bitmask
+ * - `action_keys`: The keys of the combo in `action` (the first of which to
+ *   be released releases it), as a matrix bitmask
+ */
+static struct {
+    uint16_t        used[OPT__KB__ROWS];
+    bool            used_valid;
+    uint16_t        count;
+    bool            pending;
+    uint16_t        keys[OPT__KB__ROWS];
+    uint8_t         length;
+    uint8_t         buffer[COMBO__KEYS];
+    timer__handle_t timer;
+    _action_t       match;
+    _action_t       action;
+    uint16_t        active[OPT__KB__ROWS];
+    uint16_t        action_keys[OPT__KB__ROWS];
+} combo;
+
+// ----------------------------------------------------------------------------
+
+static void start(uint8_t row, uint8_t column, _action_t action);
+static void dispatch(bool pressed, uint8_t row, uint8_t column);
+
+// ----------------------------------------------------------------------------
+
+/**                                                functions/lookup/description
+ * Return the action word for the given key on the given layer
+ *
+ * Arguments:
+ * - `layer`: The layer-number
+ * - `row`, `column`: The position of the key
+ *
+ * Notes:
+ * - The EEPROM layout (which is kept in SRAM) takes precedence over
+ *   `_layout`, for the keys it overrides.
+ */
+static _action_t lookup(uint8_t layer, uint8_t row, uint8_t column) {
+    _action_t action = eeprom_layout__get(layer, row, column);
+
+    if (action == EEPROM_LAYOUT__NONE)
+        action = pgm_read_word( &( _layout[layer][row][column] ) );
+
+    return action;
+}
+
+/**                                               functions/resolve/description
+ * Work out the element of `resolved.layer` for the given key, for the current
+ * layer-stack
+ *
+ * Arguments:
+ * - `row`, `column`: The position of the key
+ *
+ * Notes:
+ * - The key is looked up from the top of the layer-stack down, only until a
+ *   layer where it isn't transparent is found.
+ * - Add 1 to the stack size in order to peek out of bounds on the last
+ *   iteration (if we get that far), so that layer 0 is our default (see the
+ *   documentation for ".../firmware/lib/layout/layer-stack.h").
+ */
+static void resolve(uint8_t row, uint8_t column) {
+    uint8_t size = layer_stack__size();
+    uint8_t layer = NO_LAYER;
+
+    for (uint8_t offset = 0; offset < size+1; offset++) {
+        uint8_t number = layer_stack__peek(offset);
+        if (lookup(number, row, column) != ACTION__TRANSP) {
+            layer = number;
+            break;
+        }
+    }
+
+    resolved.layer[row][column] = layer;
+    resolved.valid[row] |= (uint16_t)1 << column;
+}
+
+/**                                                   functions/run/description
+ * Do what the given action word says, for a press or a release
+ *
+ * Arguments:
+ * - `action`: The action word (see ".../common/definitions.h")
+ * - `pressed`: Whether the key was pressed (`true`) or released (`false`)
+ */
+static void run(_action_t action, bool pressed) {
+    uint16_t operand = action & 0x0FFF;
+
+    switch (action >> 12) {
+        case ACTION__KIND__KEY: {
+            uint8_t modifiers = operand >> 8;
+            uint8_t keycode   = operand & 0xFF;
+
+            if (pressed) {
+                for (uint8_t i = 0; i < 4; i++)
+                    if (modifiers & (1<<i))
+                        KF(press)(KEYBOARD__LeftControl + i);
+                if (keycode)
+                    KF(press)(keycode);
+            } else {
+                if (keycode)
+                    KF(release)(keycode);
+                for (uint8_t i = 4; i-- > 0;)
+                    if (modifiers & (1<<i))
+                        KF(release)(KEYBOARD__LeftControl + i);
+            }
+            break;
+        }
+
+        case ACTION__KIND__LAYER: {
+            uint8_t operation = operand >> 9;
+            uint8_t id        = (operand >> 4) & 0x1F;
+            uint8_t number    = operand & 0x0F;
+
+            switch (operation & ~ACTION__LAYER__NUMLOCK) {
+                case ACTION__LAYER__PUSH_POP:
+                    if (pressed) layer_stack__push(0, id, number);
+                    else         layer_stack__pop_id(id);
+                    break;
+                case ACTION__LAYER__PUSH:
+                    if (pressed) layer_stack__push(0, id, number);
+                    break;
+                case ACTION__LAYER__POP:
+                    if (pressed) layer_stack__pop_id(id);
+                    break;
+                case ACTION__LAYER__RESET:
+                    if (pressed) layer_stack__reset();
+                    return;  // (keypresses are ticked as usual)
+            }
+
+            if (operation & ACTION__LAYER__NUMLOCK) {
+                if ( (operation & ~ACTION__LAYER__NUMLOCK)
+                     == ACTION__LAYER__PUSH_POP ) {
+                    KF(press)(KEYBOARD__LockingNumLock);
+                    usb__kb__send_report();
+                    KF(release)(KEYBOARD__LockingNumLock);
+                    usb__kb__send_report();
+                } else if (pressed) {
+                    KF(press)(KEYBOARD__LockingNumLock);
+                } else {
+                    KF(release)(KEYBOARD__LockingNumLock);
+                }
+            }
+
+            _flags.tick_keypresses = false;
+            break;
+        }
+
+        case ACTION__KIND__MOUSE:
+            if (pressed)
+                KF(mouse_buttons)(operand & 1, operand & 2, operand & 4);
             else
-                continue;
-        else
-            layer = layer_stack__peek(i-1);
+                KF(mouse_buttons)(0, 0, 0);
+            break;
 
-        function = (void (*)(void))
-                   pgm_read_word( &( _layout[ layer             ]
-                                            [ row               ]
-                                            [ column            ]
-                                            [ (pressed) ? 0 : 1 ] ) );
+        case ACTION__KIND__SPECIAL:
+            if (!pressed)
+                break;
+            switch (operand) {
+                case ACTION__SPECIAL__BOOTLOADER:
+                    KF(jump_to_bootloader)();
+                    break;
+                case ACTION__SPECIAL__TOGGLE_NKRO:
+                    KF(toggle_nkro)();
+                    break;
+            }
+            break;
 
-        if (function == &KF(transp))
-            function = NULL;
+        case ACTION__KIND__TAP_MOD:  // (held; taps are sent by `decide()`)
+            run(ACTION__KEY(operand >> 8, 0), pressed);
+            break;
 
-        if (function) {
+        case ACTION__KIND__TAP_LAYER:  // (held; taps are sent by `decide()`)
             if (pressed)
-                pressed_layer[row][column] = layer;
+                layer_stack__push(0, TAP_LAYER_ID(operand >> 8), operand >> 8);
+            else
+                layer_stack__pop_id(TAP_LAYER_ID(operand >> 8));
 
-            _flags.tick_keypresses = (pressed) ? true : false;  // set default
+            _flags.tick_keypresses = false;
+            break;
 
+        case ACTION__KIND__FUNCTION: {
+            void (*function)(void) =
+                (void (*)(void))
+                pgm_read_word( &( _functions[ operand           ]
+                                            [ (pressed) ? 0 : 1 ] ) );
             (*function)();
+            break;
+        }
+
+        // `ACTION__KIND__NONE`, and anything unknown: do nothing
+    }
+}
+
+/**                                               functions/execute/description
+ * Run the given action word, and tick keypresses if appropriate
+ *
+ * Arguments:
+ * - `action`: The action word
+ * - `pressed`: Whether the key was pressed (`true`) or released (`false`)
+ */
+static void execute(_action_t action, bool pressed) {
+    _flags.tick_keypresses = (pressed) ? true : false;  // set default
+
+    run(action, pressed);
+
+    // TODO: *always* tick keypresses
+    // TODO: instead of this, set a flag for the type of key pressed,
+    // and any functions that execute can check it, and conditionally
+    // reschedule themselves to run later, if they so desire
+    if (_flags.tick_keypresses)
+        timer___tick_keypresses();
+}
+
+/**                                                  functions/exec/description
+ * Execute the given key event, with no decision pending
+ *
+ * Arguments:
+ * - `pressed`: Whether the key was pressed (`true`) or released (`false`)
+ * - `row`, `column`: The position of the key
+ *
+ * Notes:
+ * - If the key is a tap-hold key being pressed, this starts a decision,
+ *   instead of running the action word.
+ */
+static void exec(bool pressed, uint8_t row, uint8_t column) {
+
+    // if we press a key, we need to keep track of the action it was pressed
+    // with, so we can release it with the same one
+    // - even if the layer-stack, or the EEPROM layout, has changed since
+    // - `ACTION__TRANSP` means the key wasn't pressed with anything (it was
+    //   transparent all the way down), so release it on the layer it
+    //   resolves to for the current layer-stack, as normal
+    // - don't need to initialize, since we'll only read from positions that
+    //   we've previously set
+    static _action_t pressed_action[OPT__KB__ROWS][OPT__KB__COLUMNS];
+
+    _action_t action = ACTION__TRANSP;
+    uint8_t layer;
+
+    if ( resolved.changes != layer_stack__changes()
+         || resolved.eeprom_changes != eeprom_layout__changes() ) {
+        resolved.changes = layer_stack__changes();
+        resolved.eeprom_changes = eeprom_layout__changes();
+        for (uint8_t i = 0; i < OPT__KB__ROWS; i++)
+            resolved.valid[i] = 0;
+    }
+    if ( !( resolved.valid[row] & ((uint16_t)1 << column) ) )
+        resolve(row, column);
 
-            // TODO: *always* tick keypresses
-            // TODO: instead of this, set a flag for the type of key pressed,
-            // and any functions that execute can check it, and conditionally
-            // reschedule themselves to run later, if they so desire
-            if (_flags.tick_keypresses)
-                timer___tick_keypresses();
+    if (!pressed)
+        action = pressed_action[row][column];
 
+    if (action == ACTION__TRANSP) {
+        layer = resolved.layer[row][column];
+        if (layer != NO_LAYER)
+            action = lookup(layer, row, column);
+        if (pressed)
+            pressed_action[row][column] = action;
+        if (action == ACTION__TRANSP)
+            return;  // transparent all the way down (through layer 0)
+    }
+
+    if ( pressed && ( action >> 12 == ACTION__KIND__TAP_MOD
+                      || action >> 12 == ACTION__KIND__TAP_LAYER ) ) {
+        start(row, column, action);
+        return;
+    }
+
+    execute(action, pressed);
+}
+
+// ----------------------------------------------------------------------------
+// tap-hold
+
+/**                                                functions/decide/description
+ * Finish the decision in progress: hold, or tap, the tap-hold key, then
+ * execute the key events held back while it was pending
+ *
+ * Arguments:
+ * - `hold`: Whether the key is being held (`true`) or tapped (`false`)
+ *
+ * Notes:
+ * - If held, the key's release will go through `exec()` as usual, and
+ *   release the hold.  If tapped, it's been released already (that's how we
+ *   know it was tapped).
+ * - The buffer is copied out before it's executed, since executing it may
+ *   start (and even finish) another decision.
+ * - A report is sent after each event, so that (e.g.) a key pressed and
+ *   released while we were deciding still gets sent to the host.
+ */
+static void decide(bool hold) {
+    struct event buffer[OPT__TAP_HOLD__BUFFER];
+    uint8_t length = tap_hold.length;
+
+    timer__cancel(tap_hold.timer);  // (if it hasn't run already)
+    tap_hold.pending = false;
+
+    if (hold) {
+        execute(tap_hold.action, true);
+    } else {
+        _action_t tap = ACTION__KEY(0, tap_hold.action & 0xFF);
+        execute(tap, true);
+        usb__kb__send_report();
+        execute(tap, false);
+    }
+    usb__kb__send_report();
+
+    for (uint8_t i = 0; i < length; i++)
+        buffer[i] = tap_hold.buffer[i];
+    tap_hold.length = 0;
+
+    for (uint8_t i = 0; i < length; i++) {
+        dispatch(buffer[i].pressed, buffer[i].row, buffer[i].column);
+        usb__kb__send_report();
+    }
+}
+
+/**                                                functions/expire/description
+ * Decide that the tap-hold key is being held, since it's been down for
+ * `OPT__TAP_HOLD__TERM` milliseconds
+ *
+ * Notes:
+ * - Scheduled by `start()`, and run from the main loop (never in the middle
+ *   of a key being executed).
+ */
+static void expire(void * context) {
+    if (tap_hold.pending)
+        decide(true);
+}
+
+/**                                                 functions/start/description
+ * Start deciding whether the given tap-hold key is being tapped or held
+ *
+ * Arguments:
+ * - `row`, `column`: The position of the key
+ * - `action`: Its action word
+ *
+ * Notes:
+ * - If the decision can't be timed (i.e. the timer is out of events), the
+ *   key counts as held right away.
+ */
+static void start(uint8_t row, uint8_t column, _action_t action) {
+    tap_hold.pending = true;
+    tap_hold.row     = row;
+    tap_hold.column  = column;
+    tap_hold.action  = action;
+    tap_hold.length  = 0;
+
+    tap_hold.timer = timer__schedule_milliseconds( OPT__TAP_HOLD__TERM,
+                                                   &expire, NULL );
+    if (!tap_hold.timer)
+        decide(true);
+}
+
+/**                                                 functions/defer/description
+ * Handle a key event that happens while a decision is pending
+ *
+ * Arguments:
+ * - `pressed`: Whether the key was pressed (`true`) or released (`false`)
+ * - `row`, `column`: The position of the key
+ */
+static void defer(bool pressed, uint8_t row, uint8_t column) {
+    if (row == tap_hold.row && column == tap_hold.column) {
+        decide(false);  // released within the term: a tap
+        return;
+    }
+
+    if (!pressed) {
+        bool buffered = false;
+        for (uint8_t i = 0; i < tap_hold.length; i++)
+            if ( tap_hold.buffer[i].row == row
+                 && tap_hold.buffer[i].column == column )
+                buffered = true;
+
+        if (!buffered) {
+            exec(pressed, row, column);  // pressed before: not ours to hold
             return;
         }
     }
 
-    // if we get here, there was a transparent key in layer 0; do nothing
+    if (tap_hold.length == OPT__TAP_HOLD__BUFFER) {
+        decide(true);
+        dispatch(pressed, row, column);
+        return;
+    }
+
+    tap_hold.buffer[tap_hold.length++] = (struct event){ pressed, row, column };
+
+    if ( ( pressed && OPT__TAP_HOLD__HOLD_ON_OTHER_KEY_PRESS )
+         || ( !pressed && OPT__TAP_HOLD__PERMISSIVE_HOLD ) )
+        decide(true);
 }
 
+/**                                              functions/dispatch/description
+ * Execute the given key event, or hold it back if a tap-hold decision is
+ * pending
+ *
+ * Arguments:
+ * - `pressed`: Whether the key was pressed (`true`) or released (`false`)
+ * - `row`, `column`: The position of the key
+ */
+static void dispatch(bool pressed, uint8_t row, uint8_t column) {
+    if (tap_hold.pending)
+        defer(pressed, row, column);
+    else
+        exec(pressed, row, column);
+}
+
+// ----------------------------------------------------------------------------
+// combos
+
+/**                                                 functions/match/description
+ * Compare the keys held back with every combo having the key just pressed,
+ * and work out whether we can already tell what they are
+ *
+ * Arguments:
+ * - `row`, `column`: The position of the key just pressed (which must be in
+ *   `combo.keys`)
+ *
+ * Returns:
+ * - `true` if we should keep waiting (some combo has more keys than those
+ *   held back, and might still match)
+ * - `false` if not (`combo.match` is the combo they match, if any)
+ *
+ * Notes:
+ * - Any combo that might still match must have the key just pressed, so
+ *   most are skipped after reading the single word of their bitmask that
+ *   has it.  The rest are compared with `combo.keys` a row at a time.
+ */
+static bool match(uint8_t row, uint8_t column) {
+    uint16_t bit = (uint16_t)1 << column;
+    bool more = false;
+
+    combo.match = ACTION__TRANSP;
+
+    for (uint16_t i = 0; i < combo.count; i++) {
+        const _combo_t * c = &_combos[i];
+        if ( !( pgm_read_word( &c->keys[row] ) & bit ) )
+            continue;
+
+        bool equal = true;
+        uint8_t r = 0;
+        for (; r < OPT__KB__ROWS; r++) {
+            uint16_t keys = pgm_read_word( &c->keys[r] );
+            if (combo.keys[r] & ~keys)
+                break;  // `c` doesn't have all the keys held back
+            if (combo.keys[r] != keys)
+                equal = false;
+        }
+        if (r < OPT__KB__ROWS)
+            continue;
+
+        if (equal)
+            combo.match = pgm_read_word( &c->action );
+        else
+            more = true;
+    }
+
+    return more;
+}
+
+/**                                                functions/settle/description
+ * Stop holding keys back: run the combo they match, if any, or else press
+ * them, in order
+ *
+ * Notes:
+ * - If a combo is run, its keys are added to `combo.active`, so their
+ *   releases go to it, instead of to the keys.  They replace the keys of the
+ *   last combo in `combo.action_keys`, since that combo is released.
+ * - A report is sent after each key (or the combo) is pressed, in case
+ *   they're released again before the next is sent.
+ */
+static void settle(void) {
+    uint8_t buffer[COMBO__KEYS];
+    uint8_t length = combo.length;
+
+    timer__cancel(combo.timer);  // (if it hasn't run already)
+    combo.pending = false;
+    combo.length  = 0;
+
+    if (combo.match != ACTION__TRANSP) {
+        if (combo.action != ACTION__TRANSP)
+            execute(combo.action, false);  // (only one may be down at once)
+
+        combo.action = combo.match;
+        for (uint8_t row = 0; row < OPT__KB__ROWS; row++) {
+            combo.active[row] |= combo.keys[row];
+            combo.action_keys[row] = combo.keys[row];
+            combo.keys[row] = 0;
+        }
+        execute(combo.action, true);
+        usb__kb__send_report();
+        return;
+    }
+
+    for (uint8_t row = 0; row < OPT__KB__ROWS; row++)
+        combo.keys[row] = 0;
+
+    for (uint8_t i = 0; i < length; i++)
+        buffer[i] = combo.buffer[i];
+
+    for (uint8_t i = 0; i < length; i++) {
+        dispatch(true, buffer[i] >> 4, buffer[i] & 0xF);
+        usb__kb__send_report();
+    }
+}
+
+/**                                                 functions/lapse/description
+ * Stop waiting for more keys, since `OPT__COMBO__TERM` milliseconds have
+ * passed since the first was pressed
+ */
+static void lapse(void * context) {
+    if (combo.pending)
+        settle();
+}
+
+// ----------------------------------------------------------------------------
+
+void kb__layout__exec_key(bool pressed, uint8_t row, uint8_t column) {
+    uint16_t bit = (uint16_t)1 << column;
+
+    if (!combo.used_valid) {
+        for (const _combo_t * c = _combos;
+             pgm_read_word( &c->action ) != ACTION__TRANSP; c++) {
+            for (uint8_t r = 0; r < OPT__KB__ROWS; r++)
+                combo.used[r] |= pgm_read_word( &c->keys[r] );
+            combo.count++;
+        }
+        combo.used_valid = true;
+    }
+
+    if ( !pressed && (combo.active[row] & bit) ) {
+        combo.active[row] &= ~bit;
+        if (combo.action_keys[row] & bit) {
+            execute(combo.action, false);
+            combo.action = ACTION__TRANSP;
+            for (uint8_t r = 0; r < OPT__KB__ROWS; r++)
+                combo.action_keys[r] = 0;
+        }
+        return;
+    }
+
+    if (combo.pending) {
+        if ( pressed && (combo.used[row] & bit)
+                     && combo.length < COMBO__KEYS ) {
+            combo.keys[row] |= bit;
+            combo.buffer[combo.length++] = row << 4 | column;
+            if (!match(row, column))
+                settle();
+            return;
+        }
+
+        if ( !pressed && !(combo.keys[row] & bit) ) {
+            dispatch(pressed, row, column);  // not one of ours
+            return;
+        }
+
+        settle();  // (`combo.match` is up to date, from the last press)
+        kb__layout__exec_key(pressed, row, column);  // (`combo` has changed)
+        return;
+    }
+
+    if ( pressed && (combo.used[row] & bit) ) {
+        combo.pending = true;
+        combo.keys[row] |= bit;
+        combo.buffer[0] = row << 4 | column;
+        combo.length = 1;
+        if (!match(row, column)) {
+            settle();
+            return;
+        }
+
+        combo.timer = timer__schedule_milliseconds( OPT__COMBO__TERM,
+                                                    &lapse, NULL );
+        if (!combo.timer)
+            settle();
+        return;
+    }
+
+    dispatch(pressed, row, column);
+}
 
 // ----------------------------------------------------------------------------
 // ----------------------------------------------------------------------------
@@ -41,29 +41,26 @@
 // ----------------------------------------------------------------------------
 
 /**                                            macros/KEYS__DEFAULT/description
- * Define the functions for a default key (i.e. a normal key that presses and
- * releases a keycode as you'd expect)
+ * Define the action word for a default key (i.e. a normal key that presses
+ * and releases a keycode as you'd expect)
  *
  * Needed by ".../lib/layout/keys.h"
  */
-#define  KEYS__DEFAULT(name, value)             \
-    void P(name) (void) { KF(press)(value); }   \
-    void R(name) (void) { KF(release)(value); }
+#define  KEYS__DEFAULT(name, value)  \
+    enum { keys__action__##name = ACTION__KEY(0, value) }
 
 /**                                            macros/KEYS__SHIFTED/description
- * Define the functions for a "shifted" key (i.e. a key that sends a "shift"
+ * Define the action word for a "shifted" key (i.e. a key that sends a "shift"
  * along with the keycode)
  *
  * Needed by ".../lib/layout/keys.h"
  */
-#define  KEYS__SHIFTED(name, value)                             \
-    void P(name) (void) { KF(press)(KEYBOARD__LeftShift);       \
-                          KF(press)(value); }                   \
-    void R(name) (void) { KF(release)(value);                   \
-                          KF(release)(KEYBOARD__LeftShift); }
+#define  KEYS__SHIFTED(name, value)  \
+    enum { keys__action__##name = ACTION__KEY(ACTION__MOD__SHIFT, value) }
 
 /**                                    macros/KEYS__LAYER__PUSH_POP/description
- * Define the functions for a layer push-pop key (i.e. a layer shift key).
+ * Define the action words for a layer push-pop key (i.e. a layer shift key),
+ * and the matching push (only) and pop (only) keys.
  *
  * Naming Convention:
  * - Example: In the name `lpupo1l1`, we have the following:
@@ -86,24 +83,22 @@
  *   important: layers are popped based only on their `layer_id`.
  *
  * Notes:
- * - To save space, if you define a push-pop function, the push (only) and pop
- *   (only) functions may be defined as follows (using the example `lpupo1l1`
- *   from above):
- *
- *       #define  keys__press__lpu1l1    P(lpupo1l1)
- *       #define  keys__release__lpu1l1  KF(nop)
- *       #define  keys__press__lpo1l1    R(lpupo1l1)
- *       #define  keys__release__lpo1l1  KF(nop)
+ * - Using the example `lpupo1l1` from above, this defines `lpupo1l1`,
+ *   `lpu1l1`, and `lpo1l1`.
  */
-#define  KEYS__LAYER__PUSH_POP(ID, LAYER)                                   \
-    void P(lpupo##ID##l##LAYER) (void) { layer_stack__push(0, ID, LAYER);   \
-                                         _flags.tick_keypresses = false; }  \
-    void R(lpupo##ID##l##LAYER) (void) { layer_stack__pop_id(ID);           \
-                                         _flags.tick_keypresses = false; }
+#define  KEYS__LAYER__PUSH_POP(ID, LAYER)                         \
+    enum {                                                        \
+        keys__action__lpupo##ID##l##LAYER                         \
+            = ACTION__LAYER(ACTION__LAYER__PUSH_POP, ID, LAYER),  \
+        keys__action__lpu##ID##l##LAYER                           \
+            = ACTION__LAYER(ACTION__LAYER__PUSH, ID, LAYER),      \
+        keys__action__lpo##ID##l##LAYER                           \
+            = ACTION__LAYER(ACTION__LAYER__POP, ID, LAYER),       \
+    }
 
 /**                               macros/(group) layer : number pad/description
- * Define functions for pushing and popping the number pad (namely `numPush`,
- * `numPop`, and `numPuPo`)
+ * Define action words for pushing and popping the number pad (namely
+ * `numPush`, `numPop`, and `numPuPo`)
  *
  * Members:
  * - `KEYS__LAYER__NUM_PU_PO`
@@ -113,33 +108,79 @@
  * These macros are meant to be used (if necessary) in the layout file, since
  * they need to know the layer on which the number pad has been placed.
  */
-#define  KEYS__LAYER__NUM_PU_PO(ID, LAYER)                              \
-    void P(numPuPo) (void) { layer_stack__push(0, ID, LAYER);           \
-                             KF(press)(KEYBOARD__LockingNumLock);       \
-                             usb__kb__send_report();                    \
-                             KF(release)(KEYBOARD__LockingNumLock);     \
-                             usb__kb__send_report();                    \
-                             _flags.tick_keypresses = false; }          \
-    void R(numPuPo) (void) { layer_stack__pop_id(ID);                   \
-                             KF(press)(KEYBOARD__LockingNumLock);       \
-                             usb__kb__send_report();                    \
-                             KF(release)(KEYBOARD__LockingNumLock);     \
-                             usb__kb__send_report();                    \
-                             _flags.tick_keypresses = false; }
-
-#define  KEYS__LAYER__NUM_PUSH(ID, LAYER)                               \
-    void P(numPush) (void) { layer_stack__push(0, ID, LAYER);           \
-                             KF(press)(KEYBOARD__LockingNumLock);       \
-                             _flags.tick_keypresses = false; }          \
-    void R(numPush) (void) { KF(release)(KEYBOARD__LockingNumLock);     \
-                             _flags.tick_keypresses = false; }
-
-#define  KEYS__LAYER__NUM_POP(ID)                                       \
-    void P(numPop) (void) { layer_stack__pop_id(ID);                    \
-                            KF(press)(KEYBOARD__LockingNumLock);        \
-                            _flags.tick_keypresses = false; }           \
-    void R(numPop) (void) { KF(release)(KEYBOARD__LockingNumLock);      \
-                            _flags.tick_keypresses = false; }
+#define  KEYS__LAYER__NUM_PU_PO(ID, LAYER)               \
+    enum { keys__action__numPuPo                         \
+               = ACTION__LAYER( ACTION__LAYER__PUSH_POP  \
+                                | ACTION__LAYER__NUMLOCK, ID, LAYER ) }
+
+#define  KEYS__LAYER__NUM_PUSH(ID, LAYER)            \
+    enum { keys__action__numPush                     \
+               = ACTION__LAYER( ACTION__LAYER__PUSH  \
+                                | ACTION__LAYER__NUMLOCK, ID, LAYER ) }
+
+#define  KEYS__LAYER__NUM_POP(ID)                   \
+    enum { keys__action__numPop                     \
+               = ACTION__LAYER( ACTION__LAYER__POP  \
+                                | ACTION__LAYER__NUMLOCK, ID, 0 ) }
+
+/**                                    macros/(group) tap-hold keys/description
+ * Define the action word for a tap-hold key (i.e. a key that sends a keycode
+ * when tapped, and acts as a modifier or layer key when held)
+ *
+ * Members:
+ * - `KEYS__TAP_HOLD__MOD`: When held, hold down `modifiers` (a combination of
+ *   the `ACTION__MOD__...` flags)
+ * - `KEYS__TAP_HOLD__LAYER`: When held, push layer `LAYER`
+ *
+ * These macros are meant to be used (if necessary) in the layout file, e.g.
+ *
+ *     KEYS__TAP_HOLD__MOD( ctrlEsc, ACTION__MOD__CTRL, KEYBOARD__Escape );
+ *     KEYS__TAP_HOLD__LAYER( l1Space, 1, KEYBOARD__Spacebar );
+ */
+#define  KEYS__TAP_HOLD__MOD(name, modifiers, keycode)  \
+    enum { keys__action__##name = ACTION__TAP_MOD(modifiers, keycode) }
+
+#define  KEYS__TAP_HOLD__LAYER(name, LAYER, keycode)  \
+    enum { keys__action__##name = ACTION__TAP_LAYER(LAYER, keycode) }
+
+// ----------------------------------------------------------------------------
+
+/**                                          macros/KEYS__FUNCTIONS/description
+ * The list of keys defined as pairs of functions (the escape hatch, for keys
+ * that don't fit any other kind of action word)
+ *
+ * For each name in the list, we declare `P(name)` and `R(name)`, put them in
+ * `_functions`, and define the action word `K(name)` to call them.
+ *
+ * Usage:
+ * - A layout may add its own keys to the list by defining
+ *   `KEYS__LAYOUT_FUNCTIONS` before `#include`ing this file, e.g.
+ *
+ *       #define  KEYS__LAYOUT_FUNCTIONS(X)  X(myKey) X(myOtherKey)
+ *
+ *   and then defining `P(myKey)`, `R(myKey)`, etc. anywhere in the file.
+ */
+#ifndef KEYS__LAYOUT_FUNCTIONS
+    #define  KEYS__LAYOUT_FUNCTIONS(X)
+#endif
+
+#define  KEYS__FUNCTIONS(X)  \
+    X(shL2kcap)              \
+    X(shR2kcap)              \
+    KEYS__LAYOUT_FUNCTIONS(X)
+
+#define  KEYS__FUNCTION__DECLARE(name)  void P(name) (void);  \
+                                        void R(name) (void);
+#define  KEYS__FUNCTION__INDEX(name)    keys__function__##name,
+#define  KEYS__FUNCTION__ACTION(name)  \
+    keys__action__##name = ACTION__FUNCTION(keys__function__##name),
+#define  KEYS__FUNCTION__ENTRY(name)    { &P(name), &R(name) },
+
+KEYS__FUNCTIONS(KEYS__FUNCTION__DECLARE)
+enum { KEYS__FUNCTIONS(KEYS__FUNCTION__INDEX) };
+enum { KEYS__FUNCTIONS(KEYS__FUNCTION__ACTION) };
+
+static _functions_t _functions = { KEYS__FUNCTIONS(KEYS__FUNCTION__ENTRY) };
 
 // ----------------------------------------------------------------------------
 
@@ -206,22 +247,19 @@ void R(shR2kcap) (void) { KF(2_keys_capslock)(false, KEYBOARD__RightShift); }
  * meaning to, you must turn your keyboard off then on again (usually by
  * unplugging it, then plugging it back in)
  */
-void P(btldr) (void) { KF(jump_to_bootloader)(); }
-void R(btldr) (void) {}
+enum { keys__action__btldr = ACTION__SPECIAL(ACTION__SPECIAL__BOOTLOADER) };
 
 /**
  * mouse left click
  */
 
-void P(MclkL) (void) { KF(mouse_buttons)(1, 0, 0); }
-void R(MclkL) (void) { KF(mouse_buttons)(0, 0, 0); }
+enum { keys__action__MclkL = ACTION__MOUSE(1, 0, 0) };
 
 /**
  * nkro toggle
  */
  
-void P(tnkro) (void) { KF(toggle_nkro)(); }
-void R(tnkro) (void) {}
+enum { keys__action__tnkro = ACTION__SPECIAL(ACTION__SPECIAL__TOGGLE_NKRO) };
 
 // ----------------------------------------------------------------------------
 // --- layer ------------------------------------------------------------------
@@ -229,68 +267,65 @@ void R(tnkro) (void) {}
 // note: these are just some default layer key definitions; no need to stick to
 // them if they're inconvenient
 
-void P(lreset) (void) { layer_stack__reset(); }
-void R(lreset) (void) {}
+enum { keys__action__lreset = ACTION__LAYER(ACTION__LAYER__RESET, 0, 0) };
 
 KEYS__LAYER__PUSH_POP(0, 0);
-#define  keys__press__lpu0l0    P(lpupo0l0)
-#define  keys__release__lpu0l0  KF(nop)
-#define  keys__press__lpo0l0    R(lpupo0l0)
-#define  keys__release__lpo0l0  KF(nop)
-
 KEYS__LAYER__PUSH_POP(1, 1);
-#define  keys__press__lpu1l1    P(lpupo1l1)
-#define  keys__release__lpu1l1  KF(nop)
-#define  keys__press__lpo1l1    R(lpupo1l1)
-#define  keys__release__lpo1l1  KF(nop)
-
 KEYS__LAYER__PUSH_POP(2, 2);
-#define  keys__press__lpu2l2    P(lpupo2l2)
-#define  keys__release__lpu2l2  KF(nop)
-#define  keys__press__lpo2l2    R(lpupo2l2)
-#define  keys__release__lpo2l2  KF(nop)
-
 KEYS__LAYER__PUSH_POP(3, 3);
-#define  keys__press__lpu3l3    P(lpupo3l3)
-#define  keys__release__lpu3l3  KF(nop)
-#define  keys__press__lpo3l3    R(lpupo3l3)
-#define  keys__release__lpo3l3  KF(nop)
-
 KEYS__LAYER__PUSH_POP(4, 4);
-#define  keys__press__lpu4l4    P(lpupo4l4)
-#define  keys__release__lpu4l4  KF(nop)
-#define  keys__press__lpo4l4    R(lpupo4l4)
-#define  keys__release__lpo4l4  KF(nop)
-
 KEYS__LAYER__PUSH_POP(5, 5);
-#define  keys__press__lpu5l5    P(lpupo5l5)
-#define  keys__release__lpu5l5  KF(nop)
-#define  keys__press__lpo5l5    R(lpupo5l5)
-#define  keys__release__lpo5l5  KF(nop)
-
 KEYS__LAYER__PUSH_POP(6, 6);
-#define  keys__press__lpu6l6    P(lpupo6l6)
-#define  keys__release__lpu6l6  KF(nop)
-#define  keys__press__lpo6l6    R(lpupo6l6)
-#define  keys__release__lpo6l6  KF(nop)
-
 KEYS__LAYER__PUSH_POP(7, 7);
-#define  keys__press__lpu7l7    P(lpupo7l7)
-#define  keys__release__lpu7l7  KF(nop)
-#define  keys__press__lpo7l7    R(lpupo7l7)
-#define  keys__release__lpo7l7  KF(nop)
-
 KEYS__LAYER__PUSH_POP(8, 8);
-#define  keys__press__lpu8l8    P(lpupo8l8)
-#define  keys__release__lpu8l8  KF(nop)
-#define  keys__press__lpo8l8    R(lpupo8l8)
-#define  keys__release__lpo8l8  KF(nop)
-
 KEYS__LAYER__PUSH_POP(9, 9);
-#define  keys__press__lpu9l9    P(lpupo9l9)
-#define  keys__release__lpu9l9  KF(nop)
-#define  keys__press__lpo9l9    R(lpupo9l9)
-#define  keys__release__lpo9l9  KF(nop)
+
+
+// ----------------------------------------------------------------------------
+// --- combos -----------------------------------------------------------------
+
+/**                                             macros/KEYS__COMBOS/description
+ * The list of combos (keys that do something else when pressed together)
+ *
+ * For each element of the list, we put the action word and the matrix
+ * bitmask of its keys in `_combos`.
+ *
+ * Usage:
+ * - A layout may define combos by defining `KEYS__LAYOUT_COMBOS` before
+ *   `#include`ing this file, e.g.
+ *
+ *       #define  KEYS__LAYOUT_COMBOS(X)  \
+ *           X( K(esc),   0x22, 0x23 )    \
+ *           X( K(enter), 0x22, 0x23, 0x24 )
+ *
+ *   where each element is an action word, followed by `2` to `COMBO__KEYS`
+ *   key positions (as in `COMBO__ROW()`).
+ *
+ * Notes:
+ * - The action words must be defined before this point (so any of those
+ *   defined in this file, or by the layout before `#include`ing it).
+ * - Tap-hold action words don't make sense here, and aren't supported.
+ * - See ".../common/exec_key.c.h" for how combos are told from keys pressed
+ *   one after another.
+ */
+#ifndef KEYS__LAYOUT_COMBOS
+    #define  KEYS__LAYOUT_COMBOS(X)
+#endif
+
+#define  KEYS__COMBO__ENTRY(action, ...)  \
+    KEYS__COMBO__ENTRY_( action, __VA_ARGS__, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF )
+#define  KEYS__COMBO__ENTRY_(action, k1, k2, k3, k4, k5, k6, ...)  \
+    { { COMBO__ROW(0, k1, k2, k3, k4, k5, k6),                     \
+        COMBO__ROW(1, k1, k2, k3, k4, k5, k6),                     \
+        COMBO__ROW(2, k1, k2, k3, k4, k5, k6),                     \
+        COMBO__ROW(3, k1, k2, k3, k4, k5, k6),                     \
+        COMBO__ROW(4, k1, k2, k3, k4, k5, k6),                     \
+        COMBO__ROW(5, k1, k2, k3, k4, k5, k6) }, (action) },
+
+static _combos_t _combos = {
+    KEYS__LAYOUT_COMBOS(KEYS__COMBO__ENTRY)
+    { {0}, ACTION__TRANSP }
+};
 
 
 // ----------------------------------------------------------------------------
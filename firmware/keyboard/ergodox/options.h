@@ -22,7 +22,7 @@
 // firmware/main
 // ----------------------------------------------------------------------------
 
-#define  OPT__DEBOUNCE_TIME  5
+#define  OPT__SCAN_PERIOD  1
 // in milliseconds
 
 
@@ -51,6 +51,10 @@
 // ............................................................................
 // pin drive direction
 
+#define  OPT__MCP23018__SKIP_IDLE_SCANS  1
+// only check for changes (instead of scanning) while no left hand keys are
+// pressed
+
 
 // ----------------------------------------------------------------------------
 // firmware/keyboard/led
@@ -75,7 +79,53 @@
 // ----------------------------------------------------------------------------
 // ----------------------------------------------------------------------------
 
+#define  OPT__DEBOUNCE__ALGORITHM     DEBOUNCE__ASYMMETRIC
+// `DEBOUNCE__EAGER_PRESS` is faster to report presses, but a single bit of
+// noise (e.g. a garbled read from the left half) becomes a phantom keystroke
+#define  OPT__DEBOUNCE_TIME           5
+#define  OPT__DEBOUNCE__PRESS_TIME    2
+#define  OPT__DEBOUNCE__RELEASE_TIME  5
+// times in milliseconds
+
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
 #define  OPT__TWI__FREQUENCY  400000
+// in Hz; the fastest we'll try (we slow down if the bus gives errors).  Up to
+// 444kHz keeps `TWBR` within the datasheet's limits; faster (up to 1MHz)
+// often works, if you'd like to try it
+
+
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+#define  OPT__TIMER__EVENTS  16
+// the most events that may be waiting at once (across all timers)
+
+
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+#define  OPT__LAYER_STACK__SIZE    16
+// the most elements the layer-stack may hold at once
+#define  OPT__LAYER_STACK__LAYERS  16
+// layer-numbers must be less than this
+
+
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+#define  OPT__TAP_HOLD__TERM                     200
+// how long (in milliseconds) a tap-hold key must be down to count as held
+#define  OPT__TAP_HOLD__PERMISSIVE_HOLD          0
+// held if another key is pressed and released while it's down
+#define  OPT__TAP_HOLD__HOLD_ON_OTHER_KEY_PRESS  0
+// held if another key is pressed while it's down
+#define  OPT__TAP_HOLD__BUFFER                   8
+// the most key events held back while deciding
+
+#define  OPT__COMBO__TERM  50
+// how long (in milliseconds) the keys of a combo may take to all be pressed
 
 
 // ----------------------------------------------------------------------------
@@ -90,7 +140,11 @@
 // ----------------------------------------------------------------------------
 // ----------------------------------------------------------------------------
 
-#define  OPT__EEPROM_MACRO__EEPROM_SIZE  1024
+#define  OPT__EEPROM_LAYOUT__LAYERS  2
+// the layers (starting with layer 0) that may be remapped from the EEPROM
+
+#define  OPT__EEPROM_MACRO__EEPROM_SIZE  320
+// what's left of the 1024 bytes of EEPROM (each layer above takes 336)
 
 
 // ----------------------------------------------------------------------------
@@ -34,10 +34,15 @@ KEYBOARD_LAYOUTS := \
 MOUSE_ENABLE := true
 NKRO_ENABLE := true
 
+# PROFILE_ENABLE := true
+# measure the time taken by each phase of the scan cycle (see
+# '.../firmware/lib/profile.h')
+
 # -----------------------------------------------------------------------------
 
 $(call include_options_once,lib/eeprom)
 $(call include_options_once,lib/twi)
+$(call include_options_once,lib/layout/eeprom-layout)
 $(call include_options_once,lib/layout/eeprom-macro)
 $(call include_options_once,lib/layout/key-functions)
 $(call include_options_once,lib/layout/mouse)
@@ -49,6 +54,10 @@ SRC += $(wildcard $(CURDIR)/*.c)
 SRC += $(wildcard $(CURDIR)/controller/*.c)
 SRC += $(wildcard $(CURDIR)/layout/$(KEYBOARD_LAYOUT)*.c)
 
+ifeq '$(MCU)' 'host'
+	SRC += $(wildcard $(CURDIR)/controller/host/*.c)
+endif
+
 CFLAGS += -include $(wildcard $(CURDIR)/options.h)
 
 $(CURDIR)/layout/qwerty-kinesis-mod.o: $(wildcard $(CURDIR)/layout/common/*)
@@ -0,0 +1,152 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * Per-key debouncing interface
+ *
+ * Prefix: `debounce__`
+ *
+ * Sits between `kb__update_matrix()` and change detection in `main()`: the
+ * raw state of every key goes in, and the debounced state comes out.  The
+ * matrix may then be scanned much more often than the switches bounce.
+ */
+
+
+#ifndef ERGODOX_FIRMWARE__LIB__DEBOUNCE__H
+#define ERGODOX_FIRMWARE__LIB__DEBOUNCE__H
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// ----------------------------------------------------------------------------
+
+#define  DEBOUNCE__EAGER_PRESS  0
+#define  DEBOUNCE__DEFERRED     1
+#define  DEBOUNCE__ASYMMETRIC   2
+
+// ----------------------------------------------------------------------------
+
+#ifndef OPT__DEBOUNCE__ALGORITHM
+    #error "OPT__DEBOUNCE__ALGORITHM not defined"
+#endif
+#ifndef OPT__DEBOUNCE_TIME
+    #error "OPT__DEBOUNCE_TIME not defined"
+#endif
+#ifndef OPT__DEBOUNCE__PRESS_TIME
+    #error "OPT__DEBOUNCE__PRESS_TIME not defined"
+#endif
+#ifndef OPT__DEBOUNCE__RELEASE_TIME
+    #error "OPT__DEBOUNCE__RELEASE_TIME not defined"
+#endif
+
+// ----------------------------------------------------------------------------
+
+uint8_t debounce__get_algorithm (void);
+uint8_t debounce__set_algorithm (uint8_t algorithm);
+
+void debounce__update (uint16_t matrix[OPT__KB__ROWS]);
+
+
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+#endif  // ERGODOX_FIRMWARE__LIB__DEBOUNCE__H
+
+
+
+// ============================================================================
+// === documentation ==========================================================
+// ============================================================================
+
+
+// ----------------------------------------------------------------------------
+// macros ---------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+// === (group) algorithms ===
+/**                                       macros/(group) algorithms/description
+ * Valid values for `OPT__DEBOUNCE__ALGORITHM`, and for the argument to
+ * `debounce__set_algorithm()`
+ *
+ * Members:
+ * - `DEBOUNCE__EAGER_PRESS`: A press is reported as soon as it's seen; a
+ *   release once the key has been up for `OPT__DEBOUNCE_TIME`.  Fastest, but
+ *   noise (as opposed to bounce) can cause a spurious press.
+ * - `DEBOUNCE__DEFERRED`: Presses and releases are both reported once the key
+ *   has been stable for `OPT__DEBOUNCE_TIME`.  Immune to noise shorter than
+ *   that, but adds that much latency to every change.
+ * - `DEBOUNCE__ASYMMETRIC`: Like `DEBOUNCE__DEFERRED`, but presses need to be
+ *   stable for `OPT__DEBOUNCE__PRESS_TIME`, and releases for
+ *   `OPT__DEBOUNCE__RELEASE_TIME`.  Switches usually bounce less when pressed
+ *   than when released, so the press time can be kept short.
+ */
+
+// === OPT__DEBOUNCE__ALGORITHM ===
+/**                                 macros/OPT__DEBOUNCE__ALGORITHM/description
+ * The algorithm to use until `debounce__set_algorithm()` is called
+ */
+
+// === OPT__DEBOUNCE_TIME ===
+/**                                       macros/OPT__DEBOUNCE_TIME/description
+ * The number of milliseconds a key must be stable before a change is reported
+ * (for `DEBOUNCE__EAGER_PRESS`, only releases wait)
+ *
+ * Notes:
+ * - Cherry MX bounce time <= 5ms (at 16 in/sec actuation speed) (spec)
+ */
+
+// === (group) OPT__DEBOUNCE__..._TIME ===
+/**                          macros/(group) OPT__DEBOUNCE__..._TIME/description
+ * The number of milliseconds a key must be stable before a change is reported,
+ * for `DEBOUNCE__ASYMMETRIC`
+ *
+ * Members:
+ * - `OPT__DEBOUNCE__PRESS_TIME`: For presses
+ * - `OPT__DEBOUNCE__RELEASE_TIME`: For releases
+ */
+
+
+// ----------------------------------------------------------------------------
+// functions ------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+// === (group) algorithm ===
+/**                                     functions/(group) algorithm/description
+ * Get or set the debouncing algorithm in use
+ *
+ * Members:
+ * - `debounce__get_algorithm`
+ * - `debounce__set_algorithm`
+ *
+ * Arguments:
+ * - `algorithm`: One of the `DEBOUNCE__...` algorithm macros
+ *
+ * Returns:
+ * - `debounce__get_algorithm`: The algorithm in use
+ * - `debounce__set_algorithm`:
+ *     - success: `0`
+ *     - failure: [other] (`algorithm` was invalid; nothing was changed)
+ *
+ * Notes:
+ * - Keys keep their debounced state across a change of algorithm.
+ */
+
+// === debounce__update() ===
+/**                                      functions/debounce__update/description
+ * Replace the raw state of every key in `matrix` with its debounced state
+ *
+ * Arguments:
+ * - `matrix`: The matrix, as just filled in by `kb__update_matrix()`
+ *
+ * Notes:
+ * - Rows in which no key has changed, and no change is pending, cost only a
+ *   couple of comparisons.
+ * - Should be called exactly once per scan.  Time is measured with
+ *   `timer__get_milliseconds()`, so the scan period doesn't matter (as long
+ *   as it's shorter than the debounce times, which is the point).
+ */
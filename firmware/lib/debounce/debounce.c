@@ -0,0 +1,117 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * Implements the debouncing interface defined in ".../firmware/lib/debounce.h"
+ *
+ * Implementation notes:
+ * - The raw and debounced states are kept as row bitmasks, like the matrix.
+ *   Each key also remembers when its raw state last changed (the low 8 bits of
+ *   the millisecond timer suffice, since a change is only ever pending for as
+ *   long as the debounce time).
+ * - Debounce times are measured with a 1 millisecond resolution timer, so
+ *   the actual stable time required is within 1 millisecond of the nominal
+ *   one.
+ */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../../../firmware/keyboard.h"
+#include "../../../firmware/lib/timer.h"
+#include "../debounce.h"
+
+// ----------------------------------------------------------------------------
+
+#if OPT__DEBOUNCE_TIME          > UINT8_MAX \
+ || OPT__DEBOUNCE__PRESS_TIME   > UINT8_MAX \
+ || OPT__DEBOUNCE__RELEASE_TIME > UINT8_MAX
+    #error "debounce times must be <= 255 milliseconds"
+#endif
+
+// ----------------------------------------------------------------------------
+
+/**                                             variables/algorithm/description
+ * The algorithm in use
+ */
+static uint8_t algorithm = OPT__DEBOUNCE__ALGORITHM;
+
+/**                                                   variables/raw/description
+ * The state of every key at the last scan
+ */
+static uint16_t raw[OPT__KB__ROWS];
+
+/**                                             variables/debounced/description
+ * The state of every key last reported
+ */
+static uint16_t debounced[OPT__KB__ROWS];
+
+/**                                               variables/changed/description
+ * When the raw state of every key last changed (the low 8 bits of
+ * `timer__get_milliseconds()`)
+ */
+static uint8_t changed[OPT__KB__ROWS][OPT__KB__COLUMNS];
+
+// ----------------------------------------------------------------------------
+
+uint8_t debounce__get_algorithm(void) {
+    return algorithm;
+}
+
+uint8_t debounce__set_algorithm(uint8_t new_algorithm) {
+    switch (new_algorithm) {
+        case DEBOUNCE__EAGER_PRESS:
+        case DEBOUNCE__DEFERRED:
+        case DEBOUNCE__ASYMMETRIC:
+            algorithm = new_algorithm;
+            return 0;  // success
+        default:
+            return 1;  // error: invalid algorithm
+    }
+}
+
+void debounce__update(uint16_t matrix[OPT__KB__ROWS]) {
+    uint8_t now = timer__get_milliseconds();
+    uint8_t press_time;
+    uint8_t release_time;
+
+    switch (algorithm) {
+        case DEBOUNCE__EAGER_PRESS:
+            press_time   = 0;
+            release_time = OPT__DEBOUNCE_TIME;
+            break;
+        case DEBOUNCE__ASYMMETRIC:
+            press_time   = OPT__DEBOUNCE__PRESS_TIME;
+            release_time = OPT__DEBOUNCE__RELEASE_TIME;
+            break;
+        default:  // DEBOUNCE__DEFERRED
+            press_time   = OPT__DEBOUNCE_TIME;
+            release_time = OPT__DEBOUNCE_TIME;
+            break;
+    }
+
+    for (uint8_t row = 0; row < OPT__KB__ROWS; row++) {
+        uint16_t toggled = matrix[row] ^ raw[row];
+        uint16_t pending = matrix[row] ^ debounced[row];
+
+        raw[row] = matrix[row];
+
+        for (uint8_t col = 0; toggled | pending; col++) {
+            if (toggled & 1)
+                changed[row][col] = now;
+
+            if ( (pending & 1)
+                 && (uint8_t)(now - changed[row][col])
+                    >= ( (raw[row] >> col) & 1 ? press_time : release_time ) )
+                debounced[row] ^= (uint16_t)1 << col;
+
+            toggled >>= 1;
+            pending >>= 1;
+        }
+
+        matrix[row] = debounced[row];
+    }
+}
@@ -0,0 +1,16 @@
+# -----------------------------------------------------------------------------
+# Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+# Released under The MIT License (see "doc/licenses/MIT.md")
+# Project located at <https://github.com/benblazak/ergodox-firmware>
+# -----------------------------------------------------------------------------
+
+##                                                                  description
+# debounce options
+#
+# This file is meant to be included by '.../firmware/makefile'
+#
+
+
+$(call include_options_once,lib/timer)
+
+SRC += $(wildcard $(CURDIR)/*.c)
@@ -29,6 +29,7 @@
 // ----------------------------------------------------------------------------
 
 
+#include <stdbool.h>
 #include <stdint.h>
 
 // ----------------------------------------------------------------------------
@@ -43,6 +44,8 @@ uint8_t eeprom__read  (uint8_t * from);
 uint8_t eeprom__write (uint8_t * to, uint8_t data);
 uint8_t eeprom__copy  (uint8_t * to, uint8_t * from, uint8_t length);
 
+bool    eeprom__is_writing (void);
+
 
 // ----------------------------------------------------------------------------
 // ----------------------------------------------------------------------------
@@ -139,3 +142,12 @@ uint8_t eeprom__copy  (uint8_t * to, uint8_t * from, uint8_t length);
  *   (`to`..`to+length-1`) is invalid.
  */
 
+// === eeprom__is_writing() ===
+/**                                    functions/eeprom__is_writing/description
+ * Return whether any writes (or copies) are queued, or still being performed
+ *
+ * Notes:
+ * - Once this returns `false`, everything written with `eeprom__write()` and
+ *   `eeprom__copy()` may be read back.
+ */
+
@@ -88,9 +88,9 @@ typedef struct {
  * - `writing`: Indicates that writes are queued and/or being performed
  *     - If this is `true`, `write_queued()` is either running or scheduled to
  *       run, and should not be rescheduled by any function other than itself.
- *     - If this is `false`, no writes are queued or being performed, and
- *       `write_queued()` must be scheduled to run externally before writes
- *       will commence.
+ *     - If this is `false`, `write_queued()` must be scheduled to run
+ *       externally (see `schedule()`) before writes will commence.  Writes
+ *       may still be queued, if scheduling it failed.
  */
 struct {
     bool writing : 1;
@@ -175,8 +175,11 @@ static uint8_t resize_to_write(void) {
     //   the last used element
     // - if there are no empty elements at the front of the queue, this will do
     //   nothing
+    // - the unused elements at the back are copied too (which is harmless),
+    //   since `unused_back` may be negative here, while an element is being
+    //   added
     if (queue.unused_front != 0) {
-        for (uint8_t i = queue.unused_front; i < queue.allocated - unused; i++)
+        for (uint8_t i = queue.unused_front; i < queue.allocated; i++)
             queue.data[i-queue.unused_front] = queue.data[i];
 
         queue.unused_front = 0;
@@ -222,8 +225,11 @@ static uint8_t resize_to_copy(void) {
     //   the last used element
     // - if there are no empty elements at the front of the queue, this will do
     //   nothing
+    // - the unused elements at the back are copied too (which is harmless),
+    //   since `unused_back` may be negative here, while an element is being
+    //   added
     if (queue.unused_front != 0) {
-        for (uint8_t i = queue.unused_front; i < queue.allocated - unused; i++)
+        for (uint8_t i = queue.unused_front; i < queue.allocated; i++)
             queue.data[i-queue.unused_front] = queue.data[i];
 
         queue.unused_front = 0;
@@ -341,7 +347,7 @@ static void write(uint16_t to, uint8_t data) {
  * Write (or copy) the next byte of data as dictated by our queue(s), and
  * schedule the write of the next byte if necessary
  */
-static void write_queued(void) {
+static void write_queued(void * context) {
     #define  next_write     ( to_write.data[to_write.unused_front] )
     #define  next_copy      ( to_copy.data[to_copy.unused_front] )
     #define  length(queue)  ( queue.allocated       \
@@ -394,21 +400,33 @@ static void write_queued(void) {
         pop_to_write();
     }
 
-    // - `(3.5/OPT__DEBOUNCE_TIME)+1` gives us the number of cycles we need to
-    //   wait until the next write, where `3.5` is the maximum number of
-    //   milliseconds an EEPROM write can take, and `OPT__DEBOUNCE_TIME` is the
-    //   minimum number of milliseconds a scan can take.  Note that if the
-    //   division produces an integer (other than by truncation), the `+1` is
-    //   strictly unnecessary, since no truncation will be performed; but if
-    //   we're that close to needing to wait an extra cycle we may as well wait
-    //   anyway, just to be safe.
-    timer__schedule_cycles( (3.5/OPT__DEBOUNCE_TIME)+1, &write_queued );
+    // - the longest write takes 3.4 ms.  an event scheduled for `n`
+    //   milliseconds may run after as little as `n-1` real milliseconds, so
+    //   we wait for `5`.
+    // - if this fails, `schedule()` will try again later
+    status.writing = timer__schedule_milliseconds( 5, &write_queued, NULL )
+                     != 0;
 
     #undef  next_write
     #undef  next_copy
     #undef  length
 }
 
+/**                                              functions/schedule/description
+ * Schedule `write_queued()` to run, if it isn't scheduled (or running) already
+ *
+ * Notes:
+ * - The timer's event pool is shared, so scheduling may fail.  If it does,
+ *   `status.writing` stays `false`, and we try again the next time a write is
+ *   queued, or `eeprom__is_writing()` is called.  Running `write_queued()`
+ *   early is safe: `write()` waits for the last write to finish.
+ */
+static void schedule(void) {
+    if (!status.writing)
+        status.writing = timer__schedule_cycles( 0, &write_queued, NULL )
+                         != 0;
+}
+
 // ----------------------------------------------------------------------------
 // front end functions --------------------------------------------------------
 
@@ -444,10 +462,7 @@ uint8_t eeprom__write(uint8_t * address, uint8_t data) {
     to_write.data[index].to     = (uint16_t) address;
     to_write.data[index].value  = data;
 
-    if (!status.writing) {
-        timer__schedule_cycles( 0, &write_queued );
-        status.writing = true;
-    }
+    schedule();
 
     return 0;  // success
 }
@@ -475,11 +490,19 @@ uint8_t eeprom__copy(uint8_t * to, uint8_t * from, uint8_t length) {
     index = to_copy.allocated - to_copy.unused_back - 1;
     to_copy.data[index].from = (uint16_t) from;
 
-    if (!status.writing) {
-        timer__schedule_cycles( 0, &write_queued );
-        status.writing = true;
-    }
+    schedule();
 
     return 0;  // success
 }
 
+bool eeprom__is_writing(void) {
+    // - if writes are queued, but `write_queued()` couldn't be scheduled, try
+    //   again
+    bool queued = to_write.allocated - to_write.unused_front
+                                     - to_write.unused_back;
+    if (queued)
+        schedule();
+
+    return status.writing || queued;
+}
+
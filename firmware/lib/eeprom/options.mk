@@ -16,3 +16,7 @@ $(call include_options_once,lib/timer)
 
 SRC += $(wildcard $(CURDIR)/$(MCU).c)
 
+ifeq '$(MCU)' 'host'
+	SRC += $(wildcard $(CURDIR)/$(EMULATED_MCU).c)
+endif
+
@@ -0,0 +1,405 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * Host (simulation) interface
+ *
+ * Prefix: `host__`
+ *
+ * This is the hardware abstraction layer used when building the firmware for
+ * the machine doing the building, instead of for the keyboard (`make host`).
+ * The firmware core is compiled unchanged, against the replacement avr-libc
+ * headers in ".../firmware/lib/host/avr-libc", which map the registers we use
+ * onto `host__io`.  Simulated time only passes when the firmware waits for it
+ * (delays, and busy-wait polls of the timer), so runs are deterministic.
+ *
+ * The keyboard implementation must implement the "board" section, including
+ * a model of any devices it has on the TWI bus.
+ */
+
+
+#ifndef ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__H
+#define ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__H
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// ----------------------------------------------------------------------------
+
+struct host__io {
+    uint8_t  ddr[6];
+    uint8_t  port[6];
+    uint8_t  pin[6];
+
+    uint8_t  clkpr;
+    uint8_t  tccr1a;
+    uint8_t  tccr1b;
+    uint16_t ocr1a;
+    uint16_t ocr1b;
+    uint16_t ocr1c;
+
+    uint8_t  tccr3a;
+    uint8_t  tccr3b;
+    uint16_t tcnt3;
+    uint8_t  tifr3;
+
+    uint8_t  eecr;
+    uint16_t eear;
+    uint8_t  eedr;
+
+    uint8_t  sreg;
+};
+
+// ----------------------------------------------------------------------------
+
+#define  HOST__TWI__UNPLUGGED  0
+#define  HOST__TWI__NACK       1
+#define  HOST__TWI__GARBLE     2
+#define  HOST__TWI__HANG       3
+
+#define  HOST__TWI__FAULTS     4
+
+// ----------------------------------------------------------------------------
+
+// --- time ---
+uint32_t host__micros   (void);
+uint32_t host__cycles   (void);
+void     host__delay_ns (uint32_t nanoseconds);
+void     host__sleep_ns (uint32_t nanoseconds);
+void     host__poll     (void);
+void     host__exit     (void);
+
+// --- io ---
+extern struct host__io host__io;
+extern uint32_t        host__pgm_reads;
+void      host__io__sync (void);
+uint8_t * host__io__pin  (uint8_t port);
+uint8_t * host__io__eecr (void);
+
+// --- matrix ---
+bool host__matrix__is_pressed (uint8_t row, uint8_t column);
+void host__matrix__scan_started (void);
+
+// --- usb ---
+void host__usb__report ( char const *    name,
+                         uint8_t const * report,
+                         uint8_t         length );
+
+// --- twi ---
+void host__twi__started (void);
+void host__twi__byte    (void);
+void host__twi__busy    (uint32_t nanoseconds);
+bool host__twi__fault   (uint8_t fault);
+
+// --- board ---
+uint8_t host__board__pulled_low  (uint8_t port);
+bool    host__board__twi_address (uint8_t address);
+bool    host__board__twi_write   (uint8_t data);
+uint8_t host__board__twi_read    (void);
+void    host__board__twi_stop    (void);
+
+
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+#endif  // ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__H
+
+
+
+// ============================================================================
+// === documentation ==========================================================
+// ============================================================================
+
+
+// ----------------------------------------------------------------------------
+// macros ---------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+// === (group) twi faults ===
+/**                                       macros/(group) twi faults/description
+ * The kinds of fault that may be injected into the TWI bus (see
+ * `host__twi__fault()`)
+ *
+ * Members:
+ * - `HOST__TWI__UNPLUGGED`: The devices on the bus have lost power (e.g. the
+ *   left half of the keyboard has been unplugged), and don't answer.  When
+ *   power comes back, they start over from their power on state.
+ * - `HOST__TWI__NACK`: The next address byte is NACKed, whoever it's for
+ * - `HOST__TWI__GARBLE`: The next data byte read has its low bit flipped
+ * - `HOST__TWI__HANG`: The next action never finishes (e.g. a device is
+ *   holding SDA low), until the bus is recovered
+ *
+ * - `HOST__TWI__FAULTS`: The number of kinds of fault
+ */
+
+
+// ----------------------------------------------------------------------------
+// types ----------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+// === host__io ===
+/**                                           types/struct host__io/description
+ * The emulated register file
+ *
+ * Struct members:
+ * - `ddr`, `port`, `pin`: I/O port registers, indexed by `port letter - 'A'`
+ * - [other]: The register of the same name (in upper case)
+ */
+
+
+// ----------------------------------------------------------------------------
+// variables ------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+// === host__io ===
+/**                                              variables/host__io/description
+ * The emulated register file
+ *
+ * Notes:
+ * - Firmware code should access these through the usual register names (e.g.
+ *   `DDRB`), which call `host__io__sync()` first, so that peripherals (and
+ *   input pins) are up to date.  Code implementing the simulation should
+ *   access the fields directly.
+ */
+
+
+// === host__pgm_reads ===
+/**                                       variables/host__pgm_reads/description
+ * The number of program memory reads (`pgm_read_byte()` and
+ * `pgm_read_word()`) so far
+ *
+ * Notes:
+ * - On the AVR, each is an `LPM` (or two), so benchmarks can count these where
+ *   they can't count cycles.  Reset it to `0` as needed.
+ */
+
+
+// ----------------------------------------------------------------------------
+// functions ------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+
+// ----------------------------------------------------------------------------
+// time -----------------------------------------------------------------------
+
+// === host__micros() ===
+/**                                          functions/host__micros/description
+ * Return the number of simulated microseconds since power on (mod 2^32)
+ */
+
+// === host__cycles() ===
+/**                                          functions/host__cycles/description
+ * Return the number of simulated CPU cycles since power on (mod 2^32)
+ */
+
+// === host__delay_ns() ===
+/**                                        functions/host__delay_ns/description
+ * Let the given number of simulated nanoseconds pass
+ *
+ * Notes:
+ * - Used by `_delay_us()`, `_delay_ms()`, and anything else that models time
+ *   spent waiting on the hardware (e.g. TWI transfers).
+ * - Scripted key events are applied, and the simulation may end, as time
+ *   passes.
+ */
+
+// === host__sleep_ns() ===
+/**                                        functions/host__sleep_ns/description
+ * Like `host__delay_ns()`, but with the CPU asleep
+ *
+ * Notes:
+ * - Time spent asleep is reported separately in the summary printed by
+ *   `host__exit()`.
+ */
+
+// === host__poll() ===
+/**                                            functions/host__poll/description
+ * Let the time taken by one iteration of a busy-wait loop pass
+ *
+ * Notes:
+ * - Should be called by anything the firmware busy-waits on (e.g. the
+ *   millisecond timer), or the simulation will never advance.
+ */
+
+// === host__exit() ===
+/**                                            functions/host__exit/description
+ * End the simulation, after printing a summary of the run
+ */
+
+
+// ----------------------------------------------------------------------------
+// io -------------------------------------------------------------------------
+
+// === host__io__sync() ===
+/**                                        functions/host__io__sync/description
+ * Bring emulated peripherals (currently, the EEPROM and Timer/Counter 3) up
+ * to date
+ */
+
+// === host__io__pin() ===
+/**                                         functions/host__io__pin/description
+ * Bring the input values of the given port up to date, and return a pointer
+ * to its `PINx` register
+ *
+ * Arguments:
+ * - `port`: The index of the port (`port letter - 'A'`)
+ *
+ * Notes:
+ * - An output pin reads as its `PORTx` value.  An input pin reads `1` (with
+ *   or without the pull-up enabled) unless the board is pulling it low.
+ */
+
+// === host__io__eecr() ===
+/**                                        functions/host__io__eecr/description
+ * Bring the EEPROM up to date, and return a pointer to `EECR`
+ *
+ * Notes:
+ * - The firmware busy-waits on `EECR` while an EEPROM write is in progress,
+ *   so each access during a write counts as a `host__poll()`.
+ */
+
+
+// ----------------------------------------------------------------------------
+// matrix ---------------------------------------------------------------------
+
+// === host__matrix__is_pressed() ===
+/**                              functions/host__matrix__is_pressed/description
+ * Return whether the (simulated) key at the given matrix position is being
+ * held down, according to the script being replayed
+ */
+
+// === host__matrix__scan_started() ===
+/**                            functions/host__matrix__scan_started/description
+ * Note that a scan of the matrix is starting
+ *
+ * Notes:
+ * - Should be called by whatever decides when scans start.  The intervals
+ *   between calls (and so the scan start jitter) are reported in the summary
+ *   printed by `host__exit()`.
+ */
+
+
+// ----------------------------------------------------------------------------
+// usb ------------------------------------------------------------------------
+
+// === host__usb__report() ===
+/**                                     functions/host__usb__report/description
+ * Capture a report sent to the host
+ *
+ * Arguments:
+ * - `name`: The name of the interface the report was sent on (e.g. `kb`)
+ * - `report`: The report data
+ * - `length`: The length of `report`, in bytes
+ *
+ * Notes:
+ * - Reports are counted; they are only printed if they differ from the last
+ *   report sent on the same interface.
+ */
+
+
+// ----------------------------------------------------------------------------
+// twi ------------------------------------------------------------------------
+
+// === host__twi__started() ===
+/**                                    functions/host__twi__started/description
+ * Note that a (repeated) START condition has been sent on the TWI bus
+ *
+ * Notes:
+ * - Should be called by the TWI implementation.  STARTs are counted, and
+ *   reported (with the average per scan) in the summary printed by
+ *   `host__exit()`.
+ */
+
+// === host__twi__byte() ===
+/**                                       functions/host__twi__byte/description
+ * Note that a byte has been sent or received on the TWI bus
+ *
+ * Notes:
+ * - Should be called by the TWI implementation, once for each address or data
+ *   byte.  Bytes are counted like STARTs (see `host__twi__started()`).
+ */
+
+// === host__twi__busy() ===
+/**                                       functions/host__twi__busy/description
+ * Note that the TWI bus has been busy for the given number of nanoseconds
+ *
+ * Notes:
+ * - Should be called by the TWI implementation, for every action (including
+ *   time spent waiting on a hung bus).  Bus time is counted like STARTs (see
+ *   `host__twi__started()`).
+ */
+
+// === host__twi__fault() ===
+/**                                      functions/host__twi__fault/description
+ * Return whether a fault of the given kind should happen now
+ *
+ * Arguments:
+ * - `fault`: The kind of fault (see the "twi faults" group, above)
+ *
+ * Notes:
+ * - Faults are requested by the script (see ".../firmware/lib/host/sim.c"),
+ *   and each is used up by the first call that asks for it, except that
+ *   `HOST__TWI__UNPLUGGED` lasts until the devices are plugged in again (and
+ *   is reported at least once, however short the gap).
+ * - Called by the TWI implementation (or, for `HOST__TWI__UNPLUGGED`, by the
+ *   device models) wherever the fault would show up.  Faults that show up are
+ *   counted, and reported in the summary printed by `host__exit()`.
+ */
+
+
+// ----------------------------------------------------------------------------
+// board ----------------------------------------------------------------------
+
+// === host__board__pulled_low() ===
+/**                               functions/host__board__pulled_low/description
+ * Return a bitmask of the pins of the given port that are being pulled low by
+ * the keyboard's circuitry (e.g. through a pressed key, to a pin currently
+ * driven low)
+ *
+ * Arguments:
+ * - `port`: The index of the port (`port letter - 'A'`)
+ *
+ * Notes:
+ * - Implemented by the keyboard, since only it knows how things are wired.
+ * - Called by `host__io__pin()`; should read `host__io` directly.
+ */
+
+// === host__board__twi_address() ===
+/**                              functions/host__board__twi_address/description
+ * Offer an address byte, just sent after a (repeated) START, to the devices on
+ * the TWI bus
+ *
+ * Arguments:
+ * - `address`: The 7-bit address of the device, followed by the read/write bit
+ *
+ * Returns:
+ * - `true` if a device ACKed, `false` otherwise
+ *
+ * Notes:
+ * - The other `host__board__twi_...()` functions are only called while a
+ *   device has ACKed its address, and go to that device.
+ */
+
+// === host__board__twi_write() ===
+/**                                functions/host__board__twi_write/description
+ * Pass a data byte written by the master to the selected device
+ *
+ * Returns:
+ * - `true` if the device ACKed, `false` otherwise
+ */
+
+// === host__board__twi_read() ===
+/**                                 functions/host__board__twi_read/description
+ * Return the next data byte sent by the selected device, to be read by the
+ * master
+ */
+
+// === host__board__twi_stop() ===
+/**                                 functions/host__board__twi_stop/description
+ * Note that a STOP has been sent
+ */
@@ -0,0 +1,30 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * A stand-in for avr-libc's `<avr/eeprom.h>`, for host builds
+ *
+ * Notes:
+ * - `EEMEM` variables are placed in the `host_eeprom` section, which is
+ *   aligned to 2^16 bytes (see ".../firmware/lib/host/io.c").  This makes the
+ *   lower 16 bits of their addresses equal to their EEPROM addresses, which is
+ *   all the firmware ever keeps of them.  The section itself is the emulated
+ *   EEPROM.
+ */
+
+
+#ifndef ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__AVR_LIBC__AVR__EEPROM__H
+#define ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__AVR_LIBC__AVR__EEPROM__H
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+
+#define  EEMEM  __attribute__((section("host_eeprom")))
+
+
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+#endif  // ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__AVR_LIBC__AVR__EEPROM__H
@@ -0,0 +1,36 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * A stand-in for avr-libc's `<avr/interrupt.h>`, for host builds
+ *
+ * Notes:
+ * - Nothing interrupts the firmware on the host, so enabling and disabling
+ *   interrupts only changes the I bit in `SREG`.
+ */
+
+
+#ifndef ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__AVR_LIBC__AVR__INTERRUPT__H
+#define ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__AVR_LIBC__AVR__INTERRUPT__H
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+
+#include <avr/io.h>
+
+// ----------------------------------------------------------------------------
+
+#define  SREG_I  7
+
+#define  sei()  ( SREG |=  (1<<SREG_I) )
+#define  cli()  ( SREG &= ~(1<<SREG_I) )
+
+#define  ISR(vector, ...)  void vector (void)
+
+
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+#endif  // ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__AVR_LIBC__AVR__INTERRUPT__H
@@ -0,0 +1,91 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * A stand-in for avr-libc's `<avr/io.h>`, for host builds
+ *
+ * Only the registers (and register bits) used by code compiled for the host
+ * are defined.  Each register name expands to an lvalue in `host__io`,
+ * accessed after a call to `host__io__sync()` (or `host__io__pin()`, for the
+ * `PINx` registers, and `host__io__eecr()`, for `EECR`).
+ */
+
+
+#ifndef ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__AVR_LIBC__AVR__IO__H
+#define ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__AVR_LIBC__AVR__IO__H
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+
+#include "../../../host.h"
+
+// ----------------------------------------------------------------------------
+
+#define  HOST__IO(register)  ( *(host__io__sync(), &host__io.register) )
+#define  HOST__PIN(letter)   ( *host__io__pin((letter)-'A') )
+
+// ----------------------------------------------------------------------------
+
+// --- ports ---
+#define  DDRB   HOST__IO(ddr['B'-'A'])
+#define  DDRC   HOST__IO(ddr['C'-'A'])
+#define  DDRD   HOST__IO(ddr['D'-'A'])
+#define  DDRE   HOST__IO(ddr['E'-'A'])
+#define  DDRF   HOST__IO(ddr['F'-'A'])
+
+#define  PORTB  HOST__IO(port['B'-'A'])
+#define  PORTC  HOST__IO(port['C'-'A'])
+#define  PORTD  HOST__IO(port['D'-'A'])
+#define  PORTE  HOST__IO(port['E'-'A'])
+#define  PORTF  HOST__IO(port['F'-'A'])
+
+#define  PINB   HOST__PIN('B')
+#define  PINC   HOST__PIN('C')
+#define  PIND   HOST__PIN('D')
+#define  PINE   HOST__PIN('E')
+#define  PINF   HOST__PIN('F')
+
+// --- clock ---
+#define  CLKPR   HOST__IO(clkpr)
+
+// --- timer/counter 1 ---
+#define  TCCR1A  HOST__IO(tccr1a)
+#define  TCCR1B  HOST__IO(tccr1b)
+#define  OCR1A   HOST__IO(ocr1a)
+#define  OCR1B   HOST__IO(ocr1b)
+#define  OCR1C   HOST__IO(ocr1c)
+
+// --- timer/counter 3 ---
+#define  TCCR3A  HOST__IO(tccr3a)
+#define  TCCR3B  HOST__IO(tccr3b)
+#define  TCNT3   HOST__IO(tcnt3)
+#define  TIFR3   HOST__IO(tifr3)
+
+#define  CS30   0
+#define  CS31   1
+#define  CS32   2
+
+#define  TOV3   0
+
+// --- eeprom ---
+#define  EECR    ( *host__io__eecr() )
+#define  EEAR    HOST__IO(eear)
+#define  EEDR    HOST__IO(eedr)
+
+#define  EERE   0
+#define  EEPE   1
+#define  EEMPE  2
+#define  EERIE  3
+#define  EEPM0  4
+#define  EEPM1  5
+
+// --- status ---
+#define  SREG    HOST__IO(sreg)
+
+
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+#endif  // ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__AVR_LIBC__AVR__IO__H
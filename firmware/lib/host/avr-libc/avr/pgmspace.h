@@ -0,0 +1,43 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * A stand-in for avr-libc's `<avr/pgmspace.h>`, for host builds
+ *
+ * Notes:
+ * - Program memory is ordinary memory on the host.
+ * - `pgm_read_word()` returns the object pointed to, with its own type.  On
+ *   the AVR, pointers (including function pointers) are 16 bits wide, and are
+ *   read with `pgm_read_word()`; on the host they are wider, and must be read
+ *   whole.
+ * - Reads are counted in `host__pgm_reads`.
+ */
+
+
+#ifndef ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__AVR_LIBC__AVR__PGMSPACE__H
+#define ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__AVR_LIBC__AVR__PGMSPACE__H
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+
+#include <stdint.h>
+#include "../../../host.h"
+
+// ----------------------------------------------------------------------------
+
+#define  PROGMEM
+
+#define  PSTR(string)  (string)
+
+#define  pgm_read_byte(address)  \
+    ( host__pgm_reads++, *(uint8_t const *)(address) )
+#define  pgm_read_word(address)  \
+    ( host__pgm_reads++, *(address) )
+
+
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+#endif  // ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__AVR_LIBC__AVR__PGMSPACE__H
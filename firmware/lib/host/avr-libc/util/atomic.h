@@ -0,0 +1,35 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * A stand-in for avr-libc's `<util/atomic.h>`, for host builds
+ *
+ * Notes:
+ * - Nothing interrupts the firmware on the host, so every block is atomic.
+ *   The type argument is accepted and ignored.
+ */
+
+
+#ifndef ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__AVR_LIBC__UTIL__ATOMIC__H
+#define ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__AVR_LIBC__UTIL__ATOMIC__H
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+
+#include <stdint.h>
+
+// ----------------------------------------------------------------------------
+
+#define  ATOMIC_RESTORESTATE
+#define  ATOMIC_FORCEON
+
+#define  ATOMIC_BLOCK(type)  \
+    for (uint8_t host__atomic__once = 1; host__atomic__once; host__atomic__once = 0)
+
+
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+#endif  // ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__AVR_LIBC__UTIL__ATOMIC__H
@@ -0,0 +1,30 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * A stand-in for avr-libc's `<util/delay.h>`, for host builds
+ *
+ * Delays let simulated time pass.
+ */
+
+
+#ifndef ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__AVR_LIBC__UTIL__DELAY__H
+#define ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__AVR_LIBC__UTIL__DELAY__H
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+
+#include "../../../host.h"
+
+// ----------------------------------------------------------------------------
+
+#define  _delay_us(us)  host__delay_ns( (uint32_t)((us) * 1000) )
+#define  _delay_ms(ms)  host__delay_ns( (uint32_t)((ms) * 1000000) )
+
+
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+#endif  // ERGODOX_FIRMWARE__FIRMWARE__LIB__HOST__AVR_LIBC__UTIL__DELAY__H
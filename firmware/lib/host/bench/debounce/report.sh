@@ -0,0 +1,79 @@
+#!/bin/sh
+# -----------------------------------------------------------------------------
+# Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+# Released under The MIT License (see "doc/licenses/MIT.md")
+# Project located at <https://github.com/benblazak/ergodox-firmware>
+# -----------------------------------------------------------------------------
+
+##                                                                  description
+# Replay switch bounce traces with each debouncing algorithm, and report the
+# latency and false transitions of each
+#
+# Usage: report.sh <firmware.host> <traces>
+#
+# Notes:
+# - Latency is measured from the true time of each edge (the `#=` lines in
+#   the traces) to the first keyboard report of that polarity (some key down,
+#   or none) at or after it.
+# - False transitions are the reports that change the polarity more often
+#   than the true edges do (e.g. a noise spike seen as a press and a
+#   release counts as 2).
+#
+
+
+host="$1"
+traces="$2"
+
+printf '%-12s %18s %18s %12s\n' \
+    'algorithm' 'press mean/max' 'release mean/max' 'false edges'
+
+for algorithm in eager deferred asymmetric; do
+    { echo "0 d $algorithm"; cat "$traces"; } | "$host" \
+    | awk -v algorithm="$algorithm" -v traces="$traces" '
+        BEGIN {
+            while ((getline line < traces) > 0) {
+                if (line !~ /^#= /)
+                    continue
+                split(line, field, " ")
+                truth_time[++truths] = field[2]
+                truth_edge[truths]   = field[3]
+            }
+        }
+
+        /^#/ || $2 != "kb" { next }
+
+        {
+            down = ($3 != "00")
+            for (i = 5; i <= NF; i++)
+                if ($i != "00")
+                    down = 1
+            if (changes && down == last)
+                next
+            change_time[++changes] = $1
+            change_edge[changes]   = down ? "p" : "r"
+            last = down
+        }
+
+        END {
+            for (t = 1; t <= truths; t++) {
+                for (c = 1; c <= changes; c++)
+                    if ( change_edge[c] == truth_edge[t] \
+                         && change_time[c] >= truth_time[t] )
+                        break
+                if (c > changes)
+                    continue  # (missed edges show up as false edges)
+                latency = change_time[c] - truth_time[t]
+                edge = truth_edge[t]
+                total[edge] += latency
+                count[edge]++
+                if (latency > max[edge])
+                    max[edge] = latency
+            }
+            printf "%-12s %8.2f / %5.2f ms %8.2f / %5.2f ms %12d\n", \
+                   algorithm, \
+                   total["p"] / count["p"], max["p"], \
+                   total["r"] / count["r"], max["r"], \
+                   ( changes > truths ? changes - truths \
+                                      : truths - changes )
+        }'
+done
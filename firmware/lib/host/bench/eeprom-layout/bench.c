@@ -0,0 +1,305 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * Check that an EEPROM layout update switches from the old layout to the new
+ * one atomically: that power lost at any point during an update boots either
+ * the old layout or the new one, and never anything else
+ *
+ * Usage: bench-eeprom-layout.host < <script>
+ *
+ * Notes:
+ * - Linked with everything the firmware is, except ".../firmware/main.c".
+ *   The simulation ends 100 ms after the script on stdin does, so the
+ *   script must only end (with any event) after the updates are done (about
+ *   2 seconds each).
+ * - `UPDATES` updates are run, one after the other, starting from an erased
+ *   EEPROM.  The layouts alternate between the two slots, and each has a
+ *   different value for every key (with some keys not overridden).
+ * - While each update runs, every byte written to the EEPROM is recorded.
+ *   Afterwards, we boot (call `eeprom_layout__init()`) from the EEPROM as it
+ *   was before each write, and with each write torn (left erased, or half
+ *   programmed), which covers every state a power cut could leave it in.
+ *   Every boot must load either the whole old layout, or the whole new one,
+ *   and once the new one is loaded, every later boot must load it too.
+ * - Exits with status `1` if anything doesn't check out.
+ */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <avr/io.h>
+#include "../../../../keyboard.h"
+#include "../../../host.h"
+#include "../../../layout/eeprom-layout.h"
+#include "../../../timer.h"
+
+// ----------------------------------------------------------------------------
+
+/**                                                  macros/UPDATES/description
+ * The number of updates to run
+ */
+#define  UPDATES  3
+
+/**                                               macros/MAX_WRITES/description
+ * The most EEPROM writes an update may make
+ */
+#define  MAX_WRITES  1024
+
+/**                                               macros/EEPROM_MAX/description
+ * The size of the ATMega32U4's EEPROM, in bytes
+ */
+#define  EEPROM_MAX  1024
+
+/**                                               macros/TIMEOUT_MS/description
+ * How long an update may take, in milliseconds
+ */
+#define  TIMEOUT_MS  10000
+
+/**                                            macros/EEPROM_LENGTH/description
+ * The size of the emulated EEPROM (see ".../firmware/lib/host/io.c")
+ */
+#define  EEPROM_LENGTH  \
+    ( (uint16_t)(__stop_host_eeprom - __start_host_eeprom) )
+
+// ----------------------------------------------------------------------------
+
+/**                                                     types/write/description
+ * To hold one EEPROM write
+ *
+ * Struct members:
+ * - `address`: The EEPROM address written to
+ * - `data`: The value written
+ */
+struct write {
+    uint16_t address;
+    uint8_t  data;
+};
+
+// ----------------------------------------------------------------------------
+
+extern uint8_t __start_host_eeprom[];
+extern uint8_t __stop_host_eeprom[];
+
+/**                                                variables/before/description
+ * The EEPROM as it was before the update being checked
+ */
+static uint8_t before[EEPROM_MAX];
+
+/**                                                 variables/image/description
+ * The EEPROM as it was after the writes checked so far
+ */
+static uint8_t image[EEPROM_MAX];
+
+/**                                                variables/writes/description
+ * The writes made by the update being checked, in order
+ */
+static struct write writes[MAX_WRITES];
+
+/**                                               variables/written/description
+ * The number of elements in `writes`
+ */
+static uint16_t written;
+
+/**                                                variables/target/description
+ * The number of the layout being written (see `value()`)
+ */
+static uint8_t target;
+
+/**                                                variables/failed/description
+ * Whether anything has gone wrong
+ */
+static bool failed;
+
+// ----------------------------------------------------------------------------
+
+/**                                                 functions/value/description
+ * Return the action word the given key has in layout number `n`
+ *
+ * Notes:
+ * - Layout `0` is the erased EEPROM, which overrides nothing.
+ */
+static uint16_t value(uint8_t n, uint8_t layer, uint8_t row, uint8_t column) {
+    if (!n || (row + column + n) % 4 == 0)
+        return EEPROM_LAYOUT__NONE;
+
+    return n << 12 | layer << 8 | row << 4 | column;
+}
+
+/**                                                functions/source/description
+ * An `eeprom_layout__source_t`, for layout number `target`
+ */
+static uint16_t source(uint8_t layer, uint8_t row, uint8_t column) {
+    return value(target, layer, row, column);
+}
+
+/**                                             functions/is_layout/description
+ * Return whether the layout in use is layout number `n`
+ */
+static bool is_layout(uint8_t n) {
+    for (uint8_t l = 0; l < OPT__EEPROM_LAYOUT__LAYERS; l++)
+        for (uint8_t r = 0; r < OPT__KB__ROWS; r++)
+            for (uint8_t c = 0; c < OPT__KB__COLUMNS; c++)
+                if (eeprom_layout__get(l, r, c) != value(n, l, r, c))
+                    return false;
+    return true;
+}
+
+/**                                                  functions/boot/description
+ * Boot from `image`, with the byte at `address` set to `data`
+ *
+ * Returns:
+ * - `1` if layout number `target` was loaded
+ * - `0` if the one before it was
+ * - `-1` if anything else was
+ */
+static int8_t boot(uint16_t address, uint8_t data) {
+    memcpy(__start_host_eeprom, image, EEPROM_LENGTH);
+    __start_host_eeprom[address] = data;
+
+    eeprom_layout__init();
+
+    if (is_layout(target))
+        return 1;
+    if (is_layout(target - 1))
+        return 0;
+    return -1;
+}
+
+/**                                                   functions/run/description
+ * Run layout update number `target`, recording every EEPROM write it makes
+ *
+ * Returns:
+ * - The time the update took, in milliseconds
+ *
+ * Notes:
+ * - The emulated EEPROM changes as soon as a write is started.  Writes are
+ *   at least 5 ms apart (see ".../firmware/lib/eeprom"), and the EEPROM is
+ *   compared with `image` every millisecond, so each byte that changed is one
+ *   write.  (Writes of a byte's current value are skipped by the driver.)
+ */
+static uint32_t run(void) {
+    uint32_t start = timer__get_milliseconds();
+    uint8_t changes = eeprom_layout__changes();
+
+    written = 0;
+    memcpy(before, __start_host_eeprom, EEPROM_LENGTH);
+    memcpy(image,  __start_host_eeprom, EEPROM_LENGTH);
+
+    if (eeprom_layout__update(&source)) {
+        printf("error: update %u couldn't be started\n", target);
+        failed = true;
+    }
+    if (!eeprom_layout__update(&source)) {
+        printf("error: update %u could be started twice\n", target);
+        failed = true;
+    }
+
+    while ( eeprom_layout__is_writing()
+            && timer__get_milliseconds() - start < TIMEOUT_MS ) {
+        timer__wait_for_scan();
+        timer___tick_cycles();
+        timer___tick_milliseconds();
+
+        for (uint16_t a = 0; a < EEPROM_LENGTH; a++) {
+            if (__start_host_eeprom[a] == image[a])
+                continue;
+            image[a] = __start_host_eeprom[a];
+            if (written < MAX_WRITES)
+                writes[written++] = (struct write){ a, image[a] };
+        }
+    }
+
+    if ( eeprom_layout__is_writing() || written == MAX_WRITES
+         || !is_layout(target) || eeprom_layout__changes() == changes ) {
+        printf("error: update %u didn't finish, or didn't switch\n", target);
+        failed = true;
+    }
+
+    return timer__get_milliseconds() - start;
+}
+
+/**                                                 functions/check/description
+ * Boot from the EEPROM as it was before each of the writes recorded by
+ * `run()`, and as it would be if each of them were torn, and print what was
+ * loaded
+ *
+ * Notes:
+ * - A torn write leaves the byte erased (if the erase finished, but the
+ *   write didn't start), or somewhere between erased and written (we try the
+ *   new value with either half still erased).
+ * - After the last write, the EEPROM is as `run()` left it.
+ */
+static void check(uint32_t time) {
+    uint32_t boots = 0, old = 0, new = 0;
+    int32_t switched = -1;
+
+    memcpy(image, before, EEPROM_LENGTH);
+
+    for (uint16_t w = 0; w <= written; w++) {
+        int8_t loaded = boot(0, image[0]);
+        boots++;
+        if (loaded == 1 && switched < 0)
+            switched = w;
+        if (loaded < 0 || (loaded == 0 && switched >= 0)) {
+            printf("error: update %u: boot before write %u\n", target, w);
+            failed = true;
+        }
+        old += loaded == 0;
+        new += loaded == 1;
+
+        if (w == written)
+            break;
+
+        uint16_t address = writes[w].address;
+        uint8_t  data    = writes[w].data;
+        uint8_t const torn[] = { 0xFF, data | 0x0F, data | 0xF0 };
+        for (uint8_t t = 0; t < sizeof(torn); t++) {
+            if (torn[t] == image[address] || torn[t] == data)
+                continue;
+            int8_t l = boot(address, torn[t]);
+            boots++;
+            if (l < 0 || (l == 0 && switched >= 0)) {
+                printf( "error: update %u: boot with write %u torn "
+                        "(0x%02X)\n", target, w, torn[t] );
+                failed = true;
+            }
+            old += l == 0;
+            new += l == 1;
+        }
+
+        image[address] = data;
+    }
+
+    printf( "update %u: %u writes in %lu ms; %lu boots: %lu old, %lu new, "
+            "%lu neither; new from write %ld\n",
+            target, written, (unsigned long) time, (unsigned long) boots,
+            (unsigned long) old, (unsigned long) new,
+            (unsigned long) (boots - old - new), (long) switched );
+
+    boot(0, image[0]);  // (as `run()` left it)
+}
+
+// ----------------------------------------------------------------------------
+
+int main(void) {
+    if (EEPROM_LENGTH > EEPROM_MAX) {
+        printf("error: the EEPROM is bigger than `EEPROM_MAX`\n");
+        return 1;
+    }
+
+    eeprom_layout__init();
+
+    timer__init();
+    timer__set_scan_period(1);
+
+    for (target = 1; target <= UPDATES; target++)
+        check(run());
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,172 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * Measure the cost of a key event, and of a layer change, with layer-stacks
+ * of different depths
+ *
+ * Usage: bench-exec-key.host
+ *
+ * Notes:
+ * - Linked with everything the firmware is, except ".../firmware/main.c", so
+ *   this measures the layout the firmware is built with.  The keys measured
+ *   are positions in the default layout ("repa"): the thumb space key, which
+ *   is transparent on layers 1 and 4 (so it costs the most), and a letter,
+ *   which isn't.
+ * - The stack holds `depth` layers over layer 0, alternately 1 and 4.
+ * - Each case runs `EVENTS` presses and releases, and the best of `RUNS` runs
+ *   is reported, in nanoseconds per event.  The layer change is a push and
+ *   a pop, each followed by a press and release of the letter (which may have
+ *   to be resolved again), and is reported per push or pop.
+ * - Program memory reads (see `host__pgm_reads`) are counted as well, since
+ *   on the AVR they're a large part of the cost, and the host's timings don't
+ *   show it.  They're counted after the runs, so the layout's lookup tables
+ *   are in the state they'd be in with the key in constant use.
+ */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include "../../../../keyboard.h"
+#include "../../../host.h"
+#include "../../../layout/eeprom-layout.h"
+#include "../../../layout/layer-stack.h"
+
+// ----------------------------------------------------------------------------
+
+/**                                                   macros/EVENTS/description
+ * The number of events in each run
+ */
+#define  EVENTS  2000000UL
+
+/**                                                     macros/RUNS/description
+ * The number of runs of each case (the fastest is reported)
+ */
+#define  RUNS  5
+
+/**                                             macros/(group) keys/description
+ * The positions of the keys measured, as `row, column`
+ *
+ * Members:
+ * - `SPACE`: Transparent on every layer stacked, and found on layer 0
+ * - `LETTER`: Found on the top layer
+ */
+#define  SPACE   0, 3
+#define  LETTER  2, 2
+
+/**                                                 macros/LAYER_ID/description
+ * The first layer-id to push layers with (chosen so as not to collide with
+ * any the layout uses)
+ */
+#define  LAYER_ID  100
+
+// ----------------------------------------------------------------------------
+
+/**                                                   functions/now/description
+ * Return the time, in nanoseconds
+ */
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/**                                                 functions/stack/description
+ * Reset the layer-stack, and push `depth` layers, alternately 1 and 4
+ */
+static void stack(uint8_t depth) {
+    layer_stack__reset();
+    for (uint8_t i = 0; i < depth; i++)
+        layer_stack__push(0, LAYER_ID + i, (i & 1) ? 4 : 1);
+}
+
+/**                                                   functions/key/description
+ * Print the time taken by a press and release of the key at `row, column`,
+ * in nanoseconds per event (the best of `RUNS` runs), and the number of
+ * program memory reads per event
+ */
+static void key(uint8_t row, uint8_t column) {
+    double best = 0;
+
+    for (uint8_t r = 0; r < RUNS; r++) {
+        double start = now();
+        for (uint32_t i = 0; i < EVENTS / 2; i++) {
+            kb__layout__exec_key(true,  row, column);
+            kb__layout__exec_key(false, row, column);
+        }
+        double time = (now() - start) / EVENTS;
+        if (!r || time < best)
+            best = time;
+    }
+
+    host__pgm_reads = 0;
+    kb__layout__exec_key(true,  row, column);
+    kb__layout__exec_key(false, row, column);
+
+    printf(" %8.1f %5.1f", best, host__pgm_reads / 2.0);
+}
+
+/**                                          functions/layer_change/description
+ * Print the time taken by a push or pop (along with the key events after it),
+ * in nanoseconds (the best of `RUNS` runs), and the number of program memory
+ * reads
+ */
+static void layer_change(void) {
+    double best = 0;
+
+    for (uint8_t r = 0; r < RUNS; r++) {
+        double start = now();
+        for (uint32_t i = 0; i < EVENTS / 4; i++) {
+            layer_stack__push(0, LAYER_ID + 99, 4);
+            kb__layout__exec_key(true,  LETTER);
+            kb__layout__exec_key(false, LETTER);
+            layer_stack__pop_id(LAYER_ID + 99);
+            kb__layout__exec_key(true,  LETTER);
+            kb__layout__exec_key(false, LETTER);
+        }
+        double time = (now() - start) / (EVENTS / 2);
+        if (!r || time < best)
+            best = time;
+    }
+
+    host__pgm_reads = 0;
+    layer_stack__push(0, LAYER_ID + 99, 4);
+    kb__layout__exec_key(true,  LETTER);
+    kb__layout__exec_key(false, LETTER);
+    layer_stack__pop_id(LAYER_ID + 99);
+    kb__layout__exec_key(true,  LETTER);
+    kb__layout__exec_key(false, LETTER);
+
+    printf( "layer change: %.1f ns, %.1f reads per push or pop (at depth 1)\n",
+            best, host__pgm_reads / 2.0 );
+}
+
+// ----------------------------------------------------------------------------
+
+int main(void) {
+    static uint8_t const depths[] = { 1, 4, 10 };
+
+    eeprom_layout__init();
+
+    printf("%-8s %14s %14s\n", "depth", "space", "letter");
+    for (uint8_t d = 0; d < sizeof(depths); d++) {
+        stack(depths[d]);
+        printf("%-8u", depths[d]);
+        key(SPACE);
+        key(LETTER);
+        printf("\n");
+    }
+    printf( "(ns and program memory reads per event; "
+            "best of %u runs of %lu events)\n",
+            RUNS, (unsigned long) EVENTS );
+
+    stack(1);
+    layer_change();
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+# -----------------------------------------------------------------------------
+# Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+# Released under The MIT License (see "doc/licenses/MIT.md")
+# Project located at <https://github.com/benblazak/ergodox-firmware>
+# -----------------------------------------------------------------------------
+
+##                                                                  description
+# host benchmarks
+#
+# This file is meant to be included by '.../firmware/lib/host/options.mk'
+#
+# Targets (run from '.../firmware'; each builds '$(TARGET).host' first):
+# - `make bench`: all of the below
+# - `make bench-debounce`: replay switch bounce traces with each debouncing
+#   algorithm, and report latency and false transitions
+# - `make bench-timer`: measure the cost of a timer tick, with 0 to 64 events
+#   pending (see 'timer/bench.c')
+# - `make bench-exec-key`: measure the cost of a key event, and of a layer
+#   change, with 1 to 10 layers stacked (see 'exec-key/bench.c')
+# - `make bench-tap-hold`: replay scripted uses of tap-hold keys, with each
+#   option, and check the reports against those expected; and check that
+#   ordinary typing isn't delayed by having tap-hold keys in the layout (see
+#   'tap-hold/check.sh')
+# - `make bench-eeprom-layout`: run EEPROM layout updates, and check that a
+#   power cut at any point during one boots either the old layout or the new
+#   one (see 'eeprom-layout/bench.c')
+#
+# Benchmarks written in C are built as 'bench-<name>.host', from
+# '<name>/bench.c', with the same flags as the firmware.  Those that measure
+# the firmware are linked with all of its objects, except the one with
+# `main()`.  Those that replace the layout are linked with all of them, except
+# the layout's.
+#
+
+
+BENCH_DIR := $(CURDIR)
+
+.PHONY: bench bench-debounce bench-timer bench-exec-key bench-tap-hold \
+	bench-eeprom-layout
+
+bench: bench-debounce bench-timer bench-exec-key bench-tap-hold \
+	bench-eeprom-layout
+
+bench-debounce: $(TARGET).host
+	@sh $(BENCH_DIR)/debounce/report.sh \
+		./$(TARGET).host $(BENCH_DIR)/debounce/traces.txt
+
+bench-timer: bench-timer.host
+	@./bench-timer.host
+
+bench-timer.host: $(BENCH_DIR)/timer/bench.c $(ROOTDIR)/lib/timer/timer.c
+	@echo
+	@echo '--- making $@ ---'
+	$(CC) $(strip $(CFLAGS)) $(strip $(LDFLAGS)) $< --output $@
+
+bench-exec-key: bench-exec-key.host
+	@./bench-exec-key.host < /dev/null
+
+bench-exec-key.host: $(BENCH_DIR)/exec-key/bench.c $(TARGET).host
+	@echo
+	@echo '--- making $@ ---'
+	$(CC) $(strip $(CFLAGS)) $(strip $(LDFLAGS)) \
+		$< $(filter-out ./main.host.o,$(OBJ)) --output $@
+
+bench-tap-hold: $(TARGET).host bench-tap-hold.host \
+		bench-tap-hold-permissive-hold.host \
+		bench-tap-hold-hold-on-other-key-press.host
+	@sh $(BENCH_DIR)/tap-hold/check.sh \
+		./$(TARGET).host ./bench-tap-hold $(BENCH_DIR)/tap-hold
+
+bench-tap-hold.host: $(BENCH_DIR)/tap-hold/layout.c $(TARGET).host
+	@echo
+	@echo '--- making $@ ---'
+	$(CC) $(strip $(CFLAGS)) $(strip $(LDFLAGS)) $< \
+		$(filter-out $(ROOTDIR)/keyboard/$(KEYBOARD_NAME)/layout/%,$(OBJ)) \
+		--output $@
+
+bench-tap-hold-%.host: $(BENCH_DIR)/tap-hold/layout-%.c \
+		$(BENCH_DIR)/tap-hold/layout.c $(TARGET).host
+	@echo
+	@echo '--- making $@ ---'
+	$(CC) $(strip $(CFLAGS)) $(strip $(LDFLAGS)) $< \
+		$(filter-out $(ROOTDIR)/keyboard/$(KEYBOARD_NAME)/layout/%,$(OBJ)) \
+		--output $@
+
+# the simulation ends 100 ms after the last event of its script, so the script
+# is one event, long after the updates are done
+bench-eeprom-layout: bench-eeprom-layout.host
+	@echo '3600000 r 0 0' | ./bench-eeprom-layout.host
+
+bench-eeprom-layout.host: $(BENCH_DIR)/eeprom-layout/bench.c $(TARGET).host
+	@echo
+	@echo '--- making $@ ---'
+	$(CC) $(strip $(CFLAGS)) $(strip $(LDFLAGS)) \
+		$< $(filter-out ./main.host.o,$(OBJ)) --output $@
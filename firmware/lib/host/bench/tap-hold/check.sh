@@ -0,0 +1,61 @@
+#!/bin/sh
+# -----------------------------------------------------------------------------
+# Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+# Released under The MIT License (see "doc/licenses/MIT.md")
+# Project located at <https://github.com/benblazak/ergodox-firmware>
+# -----------------------------------------------------------------------------
+
+##                                                                  description
+# Replay the tap-hold scripts, and check the reports against those expected;
+# then check that the test layout adds no latency to ordinary typing
+#
+# Usage: check.sh <firmware.host> <bench-tap-hold> <scripts>
+#
+# Notes:
+# - `<bench-tap-hold>` is the path of the test layout's builds, without the
+#   suffix: the scripts in '<scripts>/default' are replayed on
+#   '<bench-tap-hold>.host', and those in '<scripts>/<option>' on
+#   '<bench-tap-hold>-<option>.host'.
+# - The reports expected are the `#> ` lines of each script.
+# - '<scripts>/typing.txt' is replayed on both '<firmware.host>' and
+#   '<bench-tap-hold>.host'.  It uses only keys the two layouts share, so the
+#   reports must be the same, times included.
+# - Exits with status `1` if anything doesn't match.
+#
+
+
+host="$1"
+bench="$2"
+scripts="$3"
+
+failed=0
+
+for dir in "$scripts"/*/; do
+    option=$(basename "$dir")
+    if [ "$option" = default ]; then
+        binary="$bench.host"
+    else
+        binary="$bench-$option.host"
+    fi
+
+    for script in "$dir"*.txt; do
+        name="$option/$(basename "$script" .txt)"
+        if [ "$("$binary" < "$script" | grep -v '^#')" \
+             = "$(sed -n 's/^#> //p' "$script")" ]; then
+            printf '%-44s ok\n' "$name"
+        else
+            printf '%-44s FAILED\n' "$name"
+            failed=1
+        fi
+    done
+done
+
+if [ "$("$host" < "$scripts/typing.txt" | grep -v '^#')" \
+     = "$("$bench.host" < "$scripts/typing.txt" | grep -v '^#')" ]; then
+    printf '%-44s ok\n' 'typing (no added latency)'
+else
+    printf '%-44s FAILED\n' 'typing (no added latency)'
+    failed=1
+fi
+
+exit $failed
@@ -0,0 +1,16 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * The tap-hold test layout (see "layout.c"), with
+ * `OPT__TAP_HOLD__HOLD_ON_OTHER_KEY_PRESS` turned on
+ */
+
+
+#undef   OPT__TAP_HOLD__HOLD_ON_OTHER_KEY_PRESS
+#define  OPT__TAP_HOLD__HOLD_ON_OTHER_KEY_PRESS  1
+
+#include "./layout.c"
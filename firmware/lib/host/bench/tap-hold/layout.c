@@ -0,0 +1,126 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * A test layout for tap-hold keys: the first two layers of "repa", with
+ * left-hand control as Esc when tapped (and control when held), and the
+ * left-hand space as Space when tapped (and layer 1 when held)
+ *
+ * Implements the "layout" section of '.../firmware/keyboard.h'
+ *
+ * Notes:
+ * - Layer keys for layers this layout doesn't have are `nop`.
+ * - Used by `make bench-tap-hold` (see "check.sh").  The positions the
+ *   scripts use are:
+ *     - `tEsc`: row 1, column 0
+ *     - `tSpc`: row 0, column 3
+ *     - q, j, k, x: row 2, columns 2 to 5 (del is at column 3 on layer 1)
+ */
+
+
+#include "../../../../keyboard/ergodox/layout/common/definitions.h"
+
+// ----------------------------------------------------------------------------
+// matrix control
+// ----------------------------------------------------------------------------
+
+#include "../../../../keyboard/ergodox/layout/common/exec_key.c.h"
+
+
+// ----------------------------------------------------------------------------
+// LED control
+// ----------------------------------------------------------------------------
+
+void kb__led__logical_on(char led) {
+    switch(led) {
+        case 'N': kb__led__on(1); break;  // numlock
+        case 'C': kb__led__on(2); break;  // capslock
+        case 'S': kb__led__on(3); break;  // scroll lock
+        case 'O':                 break;  // compose
+        case 'K':                 break;  // kana
+    };
+}
+
+void kb__led__logical_off(char led) {
+    switch(led) {
+        case 'N': kb__led__off(1); break;  // numlock
+        case 'C': kb__led__off(2); break;  // capslock
+        case 'S': kb__led__off(3); break;  // scroll lock
+        case 'O':                  break;  // compose
+        case 'K':                  break;  // kana
+    };
+}
+
+
+// ----------------------------------------------------------------------------
+// keys
+// ----------------------------------------------------------------------------
+
+#include "../../../../keyboard/ergodox/layout/common/keys.c.h"
+
+KEYS__TAP_HOLD__MOD( tEsc, ACTION__MOD__CTRL, KEYBOARD__Escape );
+KEYS__TAP_HOLD__LAYER( tSpc, 1, KEYBOARD__Spacebar );
+
+
+// ----------------------------------------------------------------------------
+// layout
+// ----------------------------------------------------------------------------
+
+#include "../../../../keyboard/ergodox/layout/common/matrix.h"
+
+static _layout_t _layout = {
+
+// ............................................................................
+
+    MATRIX_LAYER(  // layer 0 : default
+// macro, unused,
+       K,    nop,
+// left hand ...... ......... ......... ......... ......... ......... .........
+     esc,        1,        2,        3,        4,        5,      nop,
+     tab,    quote,    comma,   period,        p,        y,      nop,
+    altR,        a,        o,        e,        u,        i,
+shL2kcap,  semicol,        q,        j,        k,        x, lpupo1l1,
+    tEsc,    grave,  bkslash,    brktL,    brktR,
+                                                                guiL,     altL,
+                                                       nop,      nop, lpupo1l1,
+                                                      tSpc,       bs,      nop,
+// right hand ..... ......... ......... ......... ......... ......... .........
+            lpu1l1,        6,        7,        8,        9,        0,     equal,
+               nop,        f,        g,        c,        r,        l,    slash,
+                           d,        h,        t,        n,        s,     dash,
+          lpupo1l1,        b,        m,        w,        v,        z, shR2kcap,
+                                arrowL,   arrowD,   arrowU,   arrowR,    ctrlR,
+    altR,     guiR,
+   pageU,      nop,      nop,
+   pageD,    enter,    space  ),
+
+// ............................................................................
+
+    MATRIX_LAYER(  // layer 1 : function and symbol keys
+// macro, unused,
+       K,    nop,
+// left hand ...... ......... ......... ......... ......... ......... .........
+    menu,       F1,       F2,       F3,       F4,       F5,      esc,
+    scrl,    prScr,    pause,     stop,      nop,      nop,   lreset,
+     num,      nop,  volumeU,      ins,     home,    pageU,
+    caps,     mute,  volumeD,      del,      end,    pageD,      nop,
+  transp,   transp,   transp,   transp,   transp,
+                                                              transp,   transp,
+                                                    transp,   transp,   transp,
+                                                    transp,   transp,   transp,
+// right hand ..... ......... ......... ......... ......... ......... .........
+            lpo1l1,       F6,       F7,       F8,       F9,      F10,      F11,
+            lreset,    tilde,    brktL,    brktR,    kpDiv,    kpMul,      F12,
+                     bkslash,   braceL,   braceR,    kpSub,    kpAdd,  kpEnter,
+               nop,     pipe,   parenL,   parenR,    space,   arrowU, shR2kcap,
+                              lessThan, grtrThan,   arrowL,   arrowD,   arrowR,
+  transp,   transp,
+  transp,   transp,   transp,
+  transp,   transp,   transp  ),
+
+// ............................................................................
+
+};
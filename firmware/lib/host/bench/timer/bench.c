@@ -0,0 +1,178 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * Measure the cost of a timer tick, with events pending
+ *
+ * Usage: bench-timer.host
+ *
+ * Notes:
+ * - ".../firmware/lib/timer/timer.c" is compiled in directly, with a larger
+ *   event pool than the keyboard's, so we can see how the cost grows.
+ * - For each number of events pending, the events either fire every
+ *   `PERIOD` ticks (rescheduling themselves, spread out evenly), or almost
+ *   never (every 65536 ticks).  Each case runs `TICKS` ticks of the cycle
+ *   timer, and the best of `RUNS` runs is reported, in nanoseconds per tick.
+ * - Every event must run exactly as often as it's due; if not (or if
+ *   scheduling fails), we say so, and exit with status `1`.
+ */
+
+
+#undef   OPT__TIMER__EVENTS
+#define  OPT__TIMER__EVENTS  64
+#define  timer_t  timer__c__timer_t  // (`<time.h>` has a `timer_t` too)
+#include "../../../timer/timer.c"
+#undef   timer_t
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// ----------------------------------------------------------------------------
+
+/**                                                    macros/TICKS/description
+ * The number of ticks in each run
+ */
+#define  TICKS  5000000UL
+
+/**                                                     macros/RUNS/description
+ * The number of runs of each case (the fastest is reported)
+ */
+#define  RUNS  3
+
+/**                                                   macros/PERIOD/description
+ * The number of ticks between runs of each event, when they're firing
+ */
+#define  PERIOD  500
+
+// ----------------------------------------------------------------------------
+
+/**                                                   types/bench_t/description
+ * To hold the state of one pending event
+ *
+ * Struct members:
+ * - `ticks`: The number of ticks to schedule the event for, each time it runs
+ * - `handle`: The handle of the event, while it's scheduled
+ */
+typedef struct {
+    uint16_t        ticks;
+    timer__handle_t handle;
+} bench_t;
+
+// ----------------------------------------------------------------------------
+
+/**                                                 variables/fired/description
+ * The number of times events have run, in this run
+ */
+static uint32_t fired;
+
+/**                                                variables/failed/description
+ * Whether anything has gone wrong
+ */
+static int failed;
+
+// ----------------------------------------------------------------------------
+
+/**                                                   functions/now/description
+ * Return the time, in nanoseconds
+ */
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/**                                                  functions/fire/description
+ * Count the run, and reschedule the event
+ */
+static void fire(void * context) {
+    bench_t * b = context;
+    fired++;
+    b->handle = timer__schedule_cycles(b->ticks, &fire, b);
+}
+
+/**                                               functions/measure/description
+ * Run `TICKS` ticks with `pending` events, firing every `period` ticks
+ *
+ * Returns:
+ * - The time taken, in nanoseconds per tick
+ *
+ * Notes:
+ * - An event scheduled for `n` ticks runs at the `n+1`th, so an event first
+ *   scheduled for `first` ticks, and then for `period-1` each time it runs,
+ *   runs `(TICKS - first - 1) / period + 1` times (if `first < TICKS`).
+ */
+static double measure(uint8_t pending, uint32_t period) {
+    bench_t  events[OPT__TIMER__EVENTS];
+    uint32_t expected = 0;
+
+    fired = 0;
+    for (uint8_t i = 0; i < pending; i++) {
+        uint16_t first = (period == PERIOD) ? i * PERIOD / pending
+                                            : period - 1;
+        events[i].ticks  = period - 1;
+        events[i].handle = timer__schedule_cycles(first, &fire, &events[i]);
+        if (!events[i].handle)
+            failed = 1;
+        if (first < TICKS)
+            expected += (TICKS - first - 1) / period + 1;
+    }
+
+    double start = now();
+    for (uint32_t t = 0; t < TICKS; t++)
+        timer___tick_cycles();
+    double time = (now() - start) / TICKS;
+
+    for (uint8_t i = 0; i < pending; i++)
+        timer__cancel(events[i].handle);
+
+    if (fired != expected) {
+        printf( "error: %u events %s: %lu runs, expected %lu\n",
+                pending, period == PERIOD ? "firing" : "never firing",
+                (unsigned long) fired, (unsigned long) expected );
+        failed = 1;
+    }
+
+    return time;
+}
+
+// ----------------------------------------------------------------------------
+
+int main(void) {
+    static uint8_t const pending[] = { 0, 8, 64 };
+    static uint32_t const periods[] = { PERIOD, 65536 };
+    static char const * const names[] = { "firing", "never firing" };
+
+    printf("%-16s", "pending");
+    for (uint8_t p = 0; p < sizeof(pending); p++)
+        printf(" %7u", pending[p]);
+    printf("\n");
+
+    for (uint8_t k = 0; k < 2; k++) {
+        printf("%-16s", names[k]);
+        for (uint8_t p = 0; p < sizeof(pending); p++) {
+            double best = 0;
+            for (uint8_t r = 0; r < RUNS; r++) {
+                double time = measure(pending[p], periods[k]);
+                if (!r || time < best)
+                    best = time;
+            }
+            printf(" %7.1f", best);
+        }
+        printf("\n");
+    }
+
+    printf( "(ns per tick, best of %u runs of %lu ticks)\n",
+            RUNS, (unsigned long) TICKS );
+
+    if (timer__get_overflows()) {
+        printf("error: %u events couldn't be scheduled\n",
+               timer__get_overflows());
+        failed = 1;
+    }
+
+    return failed;
+}
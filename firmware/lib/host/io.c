@@ -0,0 +1,223 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * Implements the "io" section of "../host.h": the emulated register file,
+ * input pins, and EEPROM
+ *
+ * Notes:
+ * - Only as much of each peripheral is emulated as the firmware relies on.
+ *   The EEPROM, for example, honors `EEMPE`, the programming mode bits, and
+ *   write timing (datasheet section 5.3), but not interrupts.  Timer/Counter
+ *   3 counts CPU cycles (with no prescaling, whatever `CS3` says) in normal
+ *   mode, and sets `TOV3` when it overflows, but raises no interrupts.
+ */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <avr/io.h>
+#include "../host.h"
+
+// ----------------------------------------------------------------------------
+
+/**                                    macros/(group) EEPROM timing/description
+ * The time an EEPROM write takes, in microseconds (datasheet table 5-1)
+ *
+ * Members:
+ * - `EEPROM_ERASE_WRITE_US`: for an atomic erase and write
+ * - `EEPROM_ERASE_OR_WRITE_US`: for an erase only, or a write only
+ */
+#define  EEPROM_ERASE_WRITE_US     3400
+#define  EEPROM_ERASE_OR_WRITE_US  1800
+
+/**                                             macros/TIFR3_MARKER/description
+ * A reserved bit of `TIFR3` (which always reads `0` on the hardware), set in
+ * every value we expose, so that we can tell when the firmware has written to
+ * the register
+ *
+ * Notes:
+ * - Writing a `1` to a flag clears it.  Without the marker, clearing a flag
+ *   that was set would look like not having touched the register at all.
+ */
+#define  TIFR3_MARKER  (1<<7)
+
+// ----------------------------------------------------------------------------
+
+struct host__io host__io;
+
+uint32_t host__pgm_reads;
+
+/**                                                variables/anchor/description
+ * An empty object that forces the `host_eeprom` section (which holds all
+ * `EEMEM` variables) to start on a 2^16 byte boundary
+ *
+ * Notes:
+ * - A section is aligned to the largest alignment of its parts, so it doesn't
+ *   matter where the linker puts this object within the section, as long as
+ *   nothing is placed before it: the objects in ".../lib/host" are linked
+ *   first, so nothing will be.
+ */
+static uint8_t anchor[0]
+    __attribute__((section("host_eeprom"), aligned(1UL<<16), used));
+
+extern uint8_t __start_host_eeprom[];
+extern uint8_t __stop_host_eeprom[];
+
+/**                                                variables/eeprom/description
+ * The state of the emulated EEPROM
+ *
+ * Struct members:
+ * - `writing`: Whether a write is in progress
+ * - `started`: When the write in progress was started (in microseconds)
+ * - `duration`: How long the write in progress will take (in microseconds)
+ */
+static struct {
+    bool     writing;
+    uint32_t started;
+    uint16_t duration;
+} eeprom;
+
+/**                                                variables/timer3/description
+ * The state of the emulated Timer/Counter 3
+ *
+ * Struct members:
+ * - `base`: When the counter was last `0` (in CPU cycles)
+ * - `counter`: The value of `TCNT3` we last exposed
+ * - `flags`: The interrupt flags (the value of `TIFR3`, without the marker)
+ */
+static struct {
+    uint32_t base;
+    uint16_t counter;
+    uint8_t  flags;
+} timer3;
+
+// ----------------------------------------------------------------------------
+
+/**                                               functions/io_init/description
+ * Put the emulated hardware into its power on state
+ *
+ * Notes:
+ * - The EEPROM starts out erased (all `1`s), as it would be on a new chip.
+ */
+__attribute__((constructor))
+static void io_init(void) {
+    if ((uintptr_t)__start_host_eeprom & UINT16_MAX) {
+        fputs("host: `host_eeprom` section is misaligned\n", stderr);
+        abort();
+    }
+    memset( __start_host_eeprom, 0xFF,
+            __stop_host_eeprom - __start_host_eeprom );
+
+    host__io.sreg = 0;
+}
+
+/**                                         functions/eeprom_update/description
+ * Perform any EEPROM operation the firmware has started
+ */
+static void eeprom_update(void) {
+    uint8_t * const eecr = &host__io.eecr;
+    uint8_t * const data = __start_host_eeprom + host__io.eear;
+    bool in_range = host__io.eear < __stop_host_eeprom - __start_host_eeprom;
+
+    if (eeprom.writing) {
+        if ((uint32_t)(host__micros() - eeprom.started) >= eeprom.duration) {
+            eeprom.writing = false;
+            *eecr &= ~(1<<EEPE);
+        }
+        return;  // the EEPROM is busy
+    }
+
+    if (*eecr & (1<<EERE)) {
+        host__io.eedr = in_range ? *data : 0xFF;
+        *eecr &= ~(1<<EERE);
+    }
+
+    if (*eecr & (1<<EEPE)) {
+        if (!(*eecr & (1<<EEMPE))) {
+            *eecr &= ~(1<<EEPE);  // not enabled: ignored by the hardware
+            return;
+        }
+
+        switch ( *eecr & ((1<<EEPM1)|(1<<EEPM0)) ) {
+            case 0:            // erase and write
+                if (in_range) *data = host__io.eedr;
+                eeprom.duration = EEPROM_ERASE_WRITE_US;
+                break;
+            case (1<<EEPM0):   // erase only
+                if (in_range) *data = 0xFF;
+                eeprom.duration = EEPROM_ERASE_OR_WRITE_US;
+                break;
+            case (1<<EEPM1):   // write only
+                if (in_range) *data &= host__io.eedr;
+                eeprom.duration = EEPROM_ERASE_OR_WRITE_US;
+                break;
+            default:
+                *eecr &= ~(1<<EEPE);
+                return;
+        }
+
+        eeprom.writing = true;
+        eeprom.started = host__micros();
+        *eecr &= ~(1<<EEMPE);
+    }
+}
+
+/**                                         functions/timer3_update/description
+ * Bring Timer/Counter 3 up to date, noticing anything the firmware has
+ * written to its registers since we last exposed them
+ */
+static void timer3_update(void) {
+    uint32_t now = host__cycles();
+
+    if (host__io.tcnt3 != timer3.counter)
+        timer3.base = now - host__io.tcnt3;
+    if (host__io.tifr3 != (timer3.flags | TIFR3_MARKER))
+        timer3.flags &= ~host__io.tifr3;
+
+    if (host__io.tccr3b & ((1<<CS32)|(1<<CS31)|(1<<CS30))) {
+        if (now - timer3.base > UINT16_MAX) {
+            timer3.flags |= (1<<TOV3);
+            timer3.base += (now - timer3.base) & ~(uint32_t)UINT16_MAX;
+        }
+    } else {
+        timer3.base = now - timer3.counter;  // stopped
+    }
+
+    host__io.tcnt3 = timer3.counter = now - timer3.base;
+    host__io.tifr3 = timer3.flags | TIFR3_MARKER;
+}
+
+// ----------------------------------------------------------------------------
+
+void host__io__sync(void) {
+    eeprom_update();
+    timer3_update();
+}
+
+uint8_t * host__io__pin(uint8_t port) {
+    uint8_t ddr  = host__io.ddr[port];
+    uint8_t out  = host__io.port[port];
+
+    host__io__sync();
+
+    host__io.pin[port] = ( (ddr & out) | ~ddr )
+                         & ~( ~ddr & host__board__pulled_low(port) );
+
+    return &host__io.pin[port];
+}
+
+uint8_t * host__io__eecr(void) {
+    if (eeprom.writing)
+        host__poll();
+
+    host__io__sync();
+
+    return &host__io.eecr;
+}
@@ -0,0 +1,23 @@
+# -----------------------------------------------------------------------------
+# Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+# Released under The MIT License (see "doc/licenses/MIT.md")
+# Project located at <https://github.com/benblazak/ergodox-firmware>
+# -----------------------------------------------------------------------------
+
+##                                                                  description
+# host (simulation) options
+#
+# This file is meant to be included by '.../firmware/makefile', before
+# anything else, when `MCU` is 'host'
+#
+
+
+EMULATED_MCU := atmega32u4
+# the processor whose peripherals we emulate; libraries with no host specific
+# implementation are compiled for this processor instead
+
+SRC += $(wildcard $(CURDIR)/*.c)
+
+CFLAGS += -I$(CURDIR)/avr-libc
+
+$(call include_options_once,lib/host/bench)
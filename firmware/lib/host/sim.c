@@ -0,0 +1,499 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * Implements the "time", "matrix", "usb", and "twi" sections of "../host.h":
+ * the simulated clock, the replay of scripted key events, the capture of USB
+ * reports, and the counting of TWI bus traffic (and injection of faults)
+ *
+ *
+ * Usage notes:
+ *
+ * - The script is read from standard input, one event per line:
+ *
+ *       <time> <p|r> <row> <column>
+ *
+ *   where `time` is in (decimal, possibly fractional) milliseconds since
+ *   power on, `p` presses and `r` releases the key, and `row` and `column` are
+ *   the (hexadecimal) matrix position of the key.  Fractional times allow
+ *   switch bounce to be scripted.  Events must be in order.  Blank lines,
+ *   and lines beginning with `#`, are ignored.
+ *
+ * - Faults may be injected into the TWI bus the same way:
+ *
+ *       <time> f <unplug|plug>
+ *       <time> f <nack|garble|hang> [<count>]
+ *
+ *   `unplug` and `plug` take the devices on the bus (i.e. the left half of
+ *   the keyboard) away, and bring them back.  The others make the next
+ *   `count` (decimal, default `1`) address bytes NACK, data bytes read
+ *   garbled, or actions hang (see the "twi faults" group in "../host.h").
+ *
+ * - The debouncing algorithm may be switched the same way:
+ *
+ *       <time> d <eager|deferred|asymmetric>
+ *
+ *   (see ".../firmware/lib/debounce.h"), so that one build can replay a
+ *   script with each.
+ *
+ * - Startup (the LED delay, and such) takes about 1 second of simulated time.
+ *
+ * - Reports are printed as they change, prefixed with the time they were sent
+ *   (in milliseconds) and the name of the interface.  The simulation ends
+ *   `TAIL_MS` milliseconds after the last event, with a summary: simulated
+ *   time, the fraction of it spent asleep, the number of scans, the shortest
+ *   and longest interval between scan starts, report counts, TWI bus traffic
+ *   (STARTs, bytes, and bus time, in total and per scan), the faults that
+ *   were injected, the number of timer overflows (and, if the profiler is
+ *   enabled, the time taken by each phase of the scan cycle).
+ */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../../firmware/keyboard.h"
+#include "../../../firmware/lib/debounce.h"
+#include "../../../firmware/lib/profile.h"
+#include "../../../firmware/lib/timer.h"
+#include "../host.h"
+
+// ----------------------------------------------------------------------------
+
+/**                                                  macros/POLL_NS/description
+ * The time taken by one iteration of a busy-wait loop, in nanoseconds
+ *
+ * Notes:
+ * - About 16 cycles at 16 MHz: a call, a few loads, a subtraction, and a
+ *   branch.
+ */
+#define  POLL_NS  1000
+
+/**                                                  macros/TAIL_MS/description
+ * The number of milliseconds to keep running after the last scripted event
+ */
+#define  TAIL_MS  100
+
+/**                                              macros/MAX_REPORTS/description
+ * The maximum number of USB interfaces to keep track of
+ */
+#define  MAX_REPORTS  4
+
+/**                                        macros/MAX_REPORT_LENGTH/description
+ * The maximum length of a USB report to keep track of
+ */
+#define  MAX_REPORT_LENGTH  32
+
+// ----------------------------------------------------------------------------
+
+/**                                                  variables/time/description
+ * Simulated time, in nanoseconds since power on
+ */
+static uint64_t time;
+
+/**                                                 variables/slept/description
+ * Time spent asleep, in nanoseconds
+ */
+static uint64_t slept;
+
+/**                                                 variables/scans/description
+ * Statistics about when scans started
+ *
+ * Struct members:
+ * - `count`: The number of scans started
+ * - `last`: When the last scan started (in nanoseconds)
+ * - `min`: The shortest interval between two scan starts (in nanoseconds)
+ * - `max`: The longest interval between two scan starts (in nanoseconds)
+ */
+static struct {
+    uint32_t count;
+    uint64_t last;
+    uint64_t min;
+    uint64_t max;
+} scans;
+
+/**                                                variables/script/description
+ * The state of the script being replayed
+ *
+ * Struct members:
+ * - `ended`: Whether we've read to the end of the script
+ * - `pending`: Whether `next` holds an event that hasn't been applied yet
+ * - `end`: When to end the simulation (once `ended` is `true`), in
+ *   nanoseconds
+ * - `next`: The next event (with `time` in nanoseconds).  If `action` is
+ *   `'f'`, the event injects `count` faults of kind `kind` (or, for
+ *   `HOST__TWI__UNPLUGGED`, unplugs (`count = 1`) or plugs (`count = 0`)
+ *   the devices on the bus); if it's `'d'`, it switches to debouncing
+ *   algorithm `kind`; otherwise, it presses or releases a key.
+ */
+static struct {
+    bool     ended;
+    bool     pending;
+    uint64_t end;
+    struct {
+        uint64_t time;
+        char     action;
+        bool     pressed;
+        uint8_t  row;
+        uint8_t  column;
+        uint8_t  kind;
+        uint16_t count;
+    } next;
+} script;
+
+/**                                                variables/matrix/description
+ * The state of every key, according to the script
+ */
+static bool matrix[OPT__KB__ROWS][OPT__KB__COLUMNS];
+
+/**                                               variables/reports/description
+ * The last report sent on each USB interface, with statistics
+ */
+static struct {
+    char const * name;
+    uint8_t      length;
+    uint8_t      data[MAX_REPORT_LENGTH];
+    uint32_t     sent;
+    uint32_t     changed;
+} reports[MAX_REPORTS];
+
+/**                                                   variables/twi/description
+ * Statistics about TWI bus traffic
+ *
+ * Struct members:
+ * - `starts`: The number of (repeated) START conditions sent
+ * - `bytes`: The number of bytes sent or received
+ * - `busy`: The time the bus has been busy, in nanoseconds
+ */
+static struct {
+    uint32_t starts;
+    uint32_t bytes;
+    uint64_t busy;
+} twi;
+
+/**                                                variables/faults/description
+ * The faults injected into the TWI bus (see `host__twi__fault()`)
+ *
+ * Struct members:
+ * - `unplugged`: Whether the devices on the bus are unplugged
+ * - `pending`: The number of faults of each kind still to happen (for
+ *   `HOST__TWI__UNPLUGGED`, whether an unplug hasn't been noticed yet)
+ * - `happened`: The number of times each kind of fault has shown up
+ */
+static struct {
+    bool     unplugged;
+    uint16_t pending[HOST__TWI__FAULTS];
+    uint32_t happened[HOST__TWI__FAULTS];
+} faults;
+
+/**                                           variables/fault_names/description
+ * The name of each kind of fault, as used in the script
+ */
+static char const * const fault_names[HOST__TWI__FAULTS] = {
+    [HOST__TWI__UNPLUGGED] = "unplug",
+    [HOST__TWI__NACK]      = "nack",
+    [HOST__TWI__GARBLE]    = "garble",
+    [HOST__TWI__HANG]      = "hang",
+};
+
+// ----------------------------------------------------------------------------
+
+/**                                           functions/parse_fault/description
+ * Parse the part of a fault event after the `f` into `script.next`
+ *
+ * Returns:
+ * - success: `true`
+ * - failure: `false`
+ */
+static bool parse_fault(char const * text) {
+    char name[8];
+    unsigned int count = 1;
+
+    int fields = sscanf(text, " %7s %u", name, &count);
+    if (fields < 1 || count < 1 || count > UINT16_MAX)
+        return false;  // error
+
+    if (!strcmp(name, "plug") || !strcmp(name, "unplug")) {
+        if (fields != 1)
+            return false;  // error
+        script.next.kind  = HOST__TWI__UNPLUGGED;
+        script.next.count = (name[0] == 'u');
+        return true;  // success
+    }
+
+    for (uint8_t i = 0; i < HOST__TWI__FAULTS; i++) {
+        if (i != HOST__TWI__UNPLUGGED && !strcmp(name, fault_names[i])) {
+            script.next.kind  = i;
+            script.next.count = count;
+            return true;  // success
+        }
+    }
+
+    return false;  // error: unknown fault
+}
+
+/**                                        functions/parse_debounce/description
+ * Parse the part of a debounce event after the `d` into `script.next`
+ *
+ * Returns:
+ * - success: `true`
+ * - failure: `false`
+ */
+static bool parse_debounce(char const * text) {
+    static char const * const names[] = {
+        [DEBOUNCE__EAGER_PRESS] = "eager",
+        [DEBOUNCE__DEFERRED]    = "deferred",
+        [DEBOUNCE__ASYMMETRIC]  = "asymmetric",
+    };
+    char name[11];
+
+    if (sscanf(text, " %10s", name) != 1)
+        return false;  // error
+
+    for (uint8_t i = 0; i < sizeof(names)/sizeof(names[0]); i++) {
+        if (!strcmp(name, names[i])) {
+            script.next.kind = i;
+            return true;  // success
+        }
+    }
+
+    return false;  // error: unknown algorithm
+}
+
+/**                                             functions/read_next/description
+ * Read the next event from the script into `script.next`
+ *
+ * Notes:
+ * - Malformed lines are reported on `stderr`, and skipped.
+ */
+static void read_next(void) {
+    char line[80];
+    double t;
+    char action;
+    int rest;
+    unsigned int row, column;
+
+    while (fgets(line, sizeof(line), stdin)) {
+        if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0')
+            continue;
+
+        bool ok = sscanf(line, "%lf %c%n", &t, &action, &rest) == 2 && t >= 0;
+        if (ok && action == 'f') {
+            ok = parse_fault(line + rest);
+        } else if (ok && action == 'd') {
+            ok = parse_debounce(line + rest);
+        } else if (ok) {
+            ok = sscanf(line + rest, "%x %x", &row, &column) == 2
+                 && (action == 'p' || action == 'r')
+                 && row < OPT__KB__ROWS && column < OPT__KB__COLUMNS;
+            script.next.pressed = (action == 'p');
+            script.next.row     = row;
+            script.next.column  = column;
+        }
+        if (!ok) {
+            fprintf(stderr, "host: ignoring malformed event: %s", line);
+            continue;
+        }
+
+        script.next.action = action;
+        script.next.time   = (uint64_t)(t * 1000000 + 0.5);
+        script.pending = true;
+        return;
+    }
+
+    script.ended = true;
+    script.end = ( script.next.time > time ? script.next.time : time )
+                 + TAIL_MS * 1000000ULL;
+}
+
+/**                                               functions/advance/description
+ * Apply scripted events that are due, and end the simulation if it's time
+ */
+static void advance(void) {
+    while (!script.ended) {
+        if (!script.pending)
+            read_next();
+        if (!script.pending || script.next.time > time)
+            break;
+
+        if (script.next.action == 'd')
+            debounce__set_algorithm(script.next.kind);
+        else if (script.next.action != 'f')
+            matrix[script.next.row][script.next.column] = script.next.pressed;
+        else if (script.next.kind == HOST__TWI__UNPLUGGED)
+            faults.pending[HOST__TWI__UNPLUGGED]
+                = faults.unplugged = script.next.count;
+        else
+            faults.pending[script.next.kind] += script.next.count;
+        script.pending = false;
+    }
+
+    if (script.ended && time >= script.end)
+        host__exit();
+}
+
+// ----------------------------------------------------------------------------
+
+uint32_t host__micros(void) {
+    return time / 1000;
+}
+
+uint32_t host__cycles(void) {
+    return time * (F_CPU / 1000000) / 1000;
+}
+
+void host__delay_ns(uint32_t nanoseconds) {
+    time += nanoseconds;
+    advance();
+}
+
+void host__sleep_ns(uint32_t nanoseconds) {
+    slept += nanoseconds;
+    host__delay_ns(nanoseconds);
+}
+
+void host__poll(void) {
+    host__delay_ns(POLL_NS);
+}
+
+void host__exit(void) {
+    printf( "# time:  %lu ms (%lu%% asleep)\n",
+            (unsigned long)(time / 1000000),
+            (unsigned long)(time ? slept * 100 / time : 0) );
+    printf("# scans: %u\n", timer__get_cycles());
+    if (timer__get_overflows())
+        printf("# timer overflows: %u\n", timer__get_overflows());
+    if (scans.count > 1)
+        printf( "# scan period: %lu.%03lu to %lu.%03lu ms\n",
+                (unsigned long)(scans.min / 1000000),
+                (unsigned long)(scans.min / 1000 % 1000),
+                (unsigned long)(scans.max / 1000000),
+                (unsigned long)(scans.max / 1000 % 1000) );
+    for (uint8_t i = 0; i < MAX_REPORTS && reports[i].name; i++)
+        printf( "# %s reports: %lu sent, %lu changed\n", reports[i].name,
+                (unsigned long) reports[i].sent,
+                (unsigned long) reports[i].changed );
+    if (twi.starts && scans.count)
+        printf( "# twi: %lu STARTs, %lu bytes, %lu us busy "
+                "(%lu.%02lu, %lu.%02lu, %lu.%02lu per scan)\n",
+                (unsigned long) twi.starts, (unsigned long) twi.bytes,
+                (unsigned long)( twi.busy / 1000 ),
+                (unsigned long)( twi.starts * 100UL / scans.count / 100 ),
+                (unsigned long)( twi.starts * 100UL / scans.count % 100 ),
+                (unsigned long)( twi.bytes * 100UL / scans.count / 100 ),
+                (unsigned long)( twi.bytes * 100UL / scans.count % 100 ),
+                (unsigned long)( twi.busy / 10 / scans.count / 100 ),
+                (unsigned long)( twi.busy / 10 / scans.count % 100 ) );
+    for (uint8_t i = 0; i < HOST__TWI__FAULTS; i++)
+        if (faults.happened[i])
+            printf( "# twi faults: %lu %s\n",
+                    (unsigned long) faults.happened[i], fault_names[i] );
+
+#ifdef PROFILE_ENABLE
+    static char const * const phases[PROFILE__PHASES] = {
+        [PROFILE__TEENSY]    = "teensy",
+        [PROFILE__MCP23018]  = "mcp23018",
+        [PROFILE__DEBOUNCE]  = "debounce",
+        [PROFILE__EXEC_KEYS] = "exec keys",
+        [PROFILE__USB]       = "usb",
+        [PROFILE__LEDS]      = "leds",
+        [PROFILE__TICK]      = "tick",
+    };
+    if (profile__stats.count)
+        for (uint8_t i = 0; i < PROFILE__PHASES; i++)
+            printf( "# profile: %-9s %5u min %5lu avg %5u max (cycles)\n",
+                    phases[i], profile__stats.phase[i].min,
+                    (unsigned long)( profile__stats.phase[i].total
+                                     / profile__stats.count ),
+                    profile__stats.phase[i].max );
+#endif
+
+    fflush(stdout);
+    exit(0);
+}
+
+// ----------------------------------------------------------------------------
+
+bool host__matrix__is_pressed(uint8_t row, uint8_t column) {
+    return matrix[row][column];
+}
+
+void host__matrix__scan_started(void) {
+    if (scans.count) {
+        uint64_t interval = time - scans.last;
+        if (scans.count == 1 || interval < scans.min) scans.min = interval;
+        if (scans.count == 1 || interval > scans.max) scans.max = interval;
+    }
+    scans.count++;
+    scans.last = time;
+}
+
+// ----------------------------------------------------------------------------
+
+void host__usb__report( char const *    name,
+                        uint8_t const * report,
+                        uint8_t         length ) {
+    uint8_t i;
+
+    for (i = 0; i < MAX_REPORTS && reports[i].name; i++)
+        if (!strcmp(reports[i].name, name))
+            break;
+    if (i == MAX_REPORTS)
+        return;  // error: too many interfaces
+
+    if (length > MAX_REPORT_LENGTH)
+        length = MAX_REPORT_LENGTH;
+
+    reports[i].name = name;
+    reports[i].sent++;
+
+    if ( reports[i].sent > 1
+         && reports[i].length == length
+         && !memcmp(reports[i].data, report, length) )
+        return;  // nothing new
+
+    reports[i].changed++;
+    reports[i].length = length;
+    memcpy(reports[i].data, report, length);
+
+    printf( "%lu.%03lu %s", (unsigned long)(time / 1000000),
+            (unsigned long)(time / 1000 % 1000), name );
+    for (uint8_t j = 0; j < length; j++)
+        printf(" %02x", report[j]);
+    printf("\n");
+}
+
+// ----------------------------------------------------------------------------
+
+void host__twi__started(void) {
+    twi.starts++;
+}
+
+void host__twi__byte(void) {
+    twi.bytes++;
+}
+
+void host__twi__busy(uint32_t nanoseconds) {
+    twi.busy += nanoseconds;
+}
+
+bool host__twi__fault(uint8_t fault) {
+    if (fault == HOST__TWI__UNPLUGGED && faults.unplugged) {
+        faults.happened[fault]++;
+        faults.pending[fault] = 0;  // (reported; no need to again)
+        return true;
+    }
+
+    if (!faults.pending[fault])
+        return false;
+
+    faults.pending[fault]--;
+    faults.happened[fault]++;
+    return true;
+}
+
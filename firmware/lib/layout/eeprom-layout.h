@@ -0,0 +1,197 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * EEPROM layout interface
+ *
+ * Prefix: `eeprom_layout__`
+ *
+ * Lets the lowest few layers of the layout be overridden, key by key, by
+ * action words kept in the EEPROM, so that keys may be remapped without
+ * reflashing (or even resetting) the keyboard, once something can send the
+ * keyboard a new layout.
+ *
+ * This file is meant to be included and used by the keyboard layout
+ * implementation.
+ *
+ *
+ * Usage notes:
+ *
+ * - The meaning of an action word is up to the layout (see, for example,
+ *   ".../firmware/keyboard/ergodox/layout/common/definitions.h").  This
+ *   library only stores them.
+ *
+ * - Layers `0` through `OPT__EEPROM_LAYOUT__LAYERS - 1` may be overridden.
+ *   Every key of those layers is either overridden, or not
+ *   (`EEPROM_LAYOUT__NONE`), in which case the layout's own action word
+ *   should be used.
+ *
+ * - Nothing in the firmware calls `eeprom_layout__update()` yet: updating is
+ *   an API only.  How a new layout gets to the keyboard (e.g. over USB, or
+ *   from keys pressed on the keyboard itself) is left for later.  Until
+ *   then, a layout stays as it was last written (and a new chip overrides
+ *   nothing).
+ */
+
+
+#ifndef ERGODOX_FIRMWARE__FIRMWARE__LIB__LAYOUT__EEPROM_LAYOUT__H
+#define ERGODOX_FIRMWARE__FIRMWARE__LIB__LAYOUT__EEPROM_LAYOUT__H
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// ----------------------------------------------------------------------------
+
+#ifndef OPT__EEPROM_LAYOUT__LAYERS
+    #error "OPT__EEPROM_LAYOUT__LAYERS not defined"
+#endif
+
+// ----------------------------------------------------------------------------
+
+#define  EEPROM_LAYOUT__NONE  0xFFFF
+
+// ----------------------------------------------------------------------------
+
+typedef uint16_t (*eeprom_layout__source_t)( uint8_t layer,
+                                             uint8_t row,
+                                             uint8_t column );
+
+// ----------------------------------------------------------------------------
+
+uint8_t  eeprom_layout__init       (void);
+uint16_t eeprom_layout__get        (uint8_t layer, uint8_t row, uint8_t column);
+uint8_t  eeprom_layout__update     (eeprom_layout__source_t source);
+bool     eeprom_layout__is_writing (void);
+uint8_t  eeprom_layout__changes    (void);
+
+
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+#endif  // ERGODOX_FIRMWARE__FIRMWARE__LIB__LAYOUT__EEPROM_LAYOUT__H
+
+
+
+// ============================================================================
+// === documentation ==========================================================
+// ============================================================================
+
+
+// ----------------------------------------------------------------------------
+// macros ---------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+// === OPT__EEPROM_LAYOUT__LAYERS ===
+/**                               macros/OPT__EEPROM_LAYOUT__LAYERS/description
+ * The number of layers (starting with layer `0`) that may be overridden
+ *
+ * Notes:
+ * - Each layer takes `2 * OPT__KB__ROWS * OPT__KB__COLUMNS` bytes of SRAM
+ *   (for the copy lookups are done from), and twice that of EEPROM (since
+ *   there are two copies of the layout there).
+ */
+
+// === EEPROM_LAYOUT__NONE ===
+/**                                      macros/EEPROM_LAYOUT__NONE/description
+ * The value returned by `eeprom_layout__get()` (and to be returned by a
+ * `eeprom_layout__source_t`) for a key that isn't overridden
+ *
+ * Notes:
+ * - This is what erased EEPROM reads as, so a new chip overrides nothing.
+ */
+
+
+// ----------------------------------------------------------------------------
+// types ----------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+// === eeprom_layout__source_t ===
+/**                                   types/eeprom_layout__source_t/description
+ * A function returning the action word a key should have in a new EEPROM
+ * layout
+ *
+ * Arguments:
+ * - `layer`: The layer-number (less than `OPT__EEPROM_LAYOUT__LAYERS`)
+ * - `row`, `column`: The position of the key
+ *
+ * Returns:
+ * - The action word, or `EEPROM_LAYOUT__NONE` if the key shouldn't be
+ *   overridden
+ */
+
+
+// ----------------------------------------------------------------------------
+// functions ------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+// === eeprom_layout__init() ===
+/**                                   functions/eeprom_layout__init/description
+ * Load the most recent valid EEPROM layout, if there is one
+ *
+ * Returns:
+ * - success: `0`
+ * - failure: [other] (no valid layout was found; nothing is overridden)
+ *
+ * Meant to be called exactly once by `kb__init()`
+ */
+
+// === eeprom_layout__get() ===
+/**                                    functions/eeprom_layout__get/description
+ * Return the action word the given key is overridden with
+ *
+ * Arguments:
+ * - `layer`: The layer-number
+ * - `row`, `column`: The position of the key
+ *
+ * Returns:
+ * - The action word, or `EEPROM_LAYOUT__NONE` if the key isn't overridden
+ *   (including if `layer >= OPT__EEPROM_LAYOUT__LAYERS`)
+ *
+ * Notes:
+ * - This reads from a copy of the layout in SRAM, never from the EEPROM, so
+ *   it's fast, and doesn't have to wait on EEPROM writes in progress.
+ */
+
+// === eeprom_layout__update() ===
+/**                                 functions/eeprom_layout__update/description
+ * Start writing a new EEPROM layout, and switch to it once it's been written
+ *
+ * Arguments:
+ * - `source`: A function returning the action word for each key of the new
+ *   layout
+ *
+ * Returns:
+ * - success: `0` (the update has been started)
+ * - failure: [other] (an update is already in progress)
+ *
+ * Notes:
+ * - The new layout is written in the background (through `eeprom__write()`),
+ *   to whichever of the two copies in the EEPROM isn't in use; the layout in
+ *   use doesn't change until the new one has been written, and checked.  If
+ *   anything goes wrong (including losing power), the old layout stays.
+ * - `source` is called a row at a time, over the second or two the update
+ *   takes, so whatever it returns shouldn't change until the update is
+ *   finished.  It may call `eeprom_layout__get()` (to keep the keys it isn't
+ *   changing as they are).
+ * - Not called by anything in the firmware yet (see the usage notes above).
+ */
+
+// === eeprom_layout__is_writing() ===
+/**                             functions/eeprom_layout__is_writing/description
+ * Return whether an update is in progress
+ */
+
+// === eeprom_layout__changes() ===
+/**                                functions/eeprom_layout__changes/description
+ * Return a number that changes whenever the EEPROM layout in use does
+ *
+ * Notes:
+ * - Only meant to be compared with a previous return value, for invalidating
+ *   anything derived from the layout.  The value is a counter, modulo 256.
+ */
+
@@ -0,0 +1,363 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * Implements the eeprom-layout functionality defined in "../eeprom-layout.h"
+ * for the ATMega32U4
+ *
+ *
+ * Implementation notes:
+ *
+ * - There are two slots in the EEPROM, each big enough for a whole EEPROM
+ *   layout, along with a version, a sequence number, and a CRC.  The slot in
+ *   use is never written to.  An update writes the other slot, and only
+ *   writes the version last, once everything else is in place.  Writing one
+ *   byte of EEPROM either happens or it doesn't, so the version write is what
+ *   switches (atomically, and persistently) from one slot to the other: if
+ *   power is lost before it's finished, the new slot won't be valid, and the
+ *   old one will be found on the next boot.
+ *
+ * - On boot, the slot with the most recent sequence number, of those that are
+ *   valid (the right version, sizes, and CRC), is used.
+ *
+ * - Lookups are done from a copy of the slot in use, in SRAM.  The copy is
+ *   only changed (to the new slot) once an update has been written, and
+ *   checked, and then all at once, from the main loop (so never in the
+ *   middle of a key being executed).
+ *
+ * - Words are stored in the EEPROM least significant byte first (as avr-gcc
+ *   would store them), but as pairs of bytes, since `struct slot` is packed,
+ *   and we need pointers to them.
+ */
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <avr/eeprom.h>
+#include <util/crc16.h>
+#include "../../../../firmware/keyboard.h"
+#include "../../../../firmware/lib/eeprom.h"
+#include "../../../../firmware/lib/timer.h"
+#include "../eeprom-layout.h"
+
+// ----------------------------------------------------------------------------
+
+/**                                                  macros/VERSION/description
+ * The version number of `struct slot`
+ *
+ * History:
+ * - 0x00: Reserved: slot being written
+ * - 0x01: First version
+ * - ... : (not yet assigned)
+ * - 0xFF: Reserved: EEPROM not yet initialized
+ */
+#define  VERSION  0x01
+
+/**                                                macros/SLOT_SIZE/description
+ * The size of `struct slot`, in bytes (for checking at preprocessing time)
+ */
+#define  SLOT_SIZE  ( 5 + 2 * OPT__EEPROM_LAYOUT__LAYERS         \
+                          * OPT__KB__ROWS * OPT__KB__COLUMNS     \
+                      + 2 )
+
+/**                                                  macros/NO_SLOT/description
+ * The value of `active.slot` when no slot is valid
+ */
+#define  NO_SLOT  UINT8_MAX
+
+/**                                                  macros/STEP_MS/description
+ * How often to check whether the EEPROM has finished the last part of an
+ * update, in milliseconds
+ */
+#define  STEP_MS  5
+
+// ----------------------------------------------------------------------------
+
+/**                               macros/OPT__EEPROM_LAYOUT__LAYERS/description
+ * Implementation notes:
+ * - The ATMega32U4 has 1024 bytes of internal EEPROM total, which we share
+ *   with ".../firmware/lib/layout/eeprom-macro"
+ */
+#if OPT__EEPROM_MACRO__EEPROM_SIZE + 2 * SLOT_SIZE > 1024
+    #error "OPT__EEPROM_LAYOUT__LAYERS is too large (not enough EEPROM)"
+#endif
+
+// ----------------------------------------------------------------------------
+
+/**                                                      types/slot/description
+ * The layout of one slot in the EEPROM
+ *
+ * Struct members:
+ * - `version`: The version of this slot's format (see `VERSION`)
+ * - `sequence`: Incremented (modulo 256) with each update, so that we can
+ *   tell which of two valid slots is the most recent
+ * - `layers`, `rows`, `columns`: The dimensions of `data` (since they effect
+ *   the precise layout of the slot; if they're different, the slot is
+ *   unusable)
+ * - `data`: The action word for each key, indexed by `[layer][row][column]`
+ *   (`EEPROM_LAYOUT__NONE` for keys that aren't overridden), as a pair of
+ *   bytes
+ * - `crc`: A CRC-16 (as computed by `_crc16_update()`, starting at `0xFFFF`)
+ *   of every byte from `sequence` through `data`
+ *
+ * Notes:
+ * - The struct must be `packed` and `aligned(1)`, so that `SLOT_SIZE` is
+ *   right.
+ */
+struct slot {
+    uint8_t  version;
+    uint8_t  sequence;
+    uint8_t  layers;
+    uint8_t  rows;
+    uint8_t  columns;
+    uint8_t  data[OPT__EEPROM_LAYOUT__LAYERS]
+                 [OPT__KB__ROWS]
+                 [OPT__KB__COLUMNS][2];
+    uint8_t  crc[2];
+} __attribute__((packed, aligned(1)));
+
+// ----------------------------------------------------------------------------
+
+/**                                                 variables/slots/description
+ * The two slots, in the EEPROM
+ */
+static struct slot slots[2] EEMEM;
+
+/**                                                variables/layout/description
+ * A copy of `slots[active.slot].data`, in SRAM, which lookups are done from
+ */
+static uint16_t layout[OPT__EEPROM_LAYOUT__LAYERS]
+                      [OPT__KB__ROWS]
+                      [OPT__KB__COLUMNS];
+
+/**                                                variables/active/description
+ * The state of the slot in use
+ *
+ * Struct members:
+ * - `slot`: The index of the slot `layout` was copied from (or `NO_SLOT`)
+ * - `sequence`: Its sequence number
+ * - `changes`: The number of times `layout` has changed (modulo 256)
+ */
+static struct {
+    uint8_t slot;
+    uint8_t sequence;
+    uint8_t changes;
+} active = { .slot = NO_SLOT };
+
+/**                                                variables/update/description
+ * The state of the update in progress
+ *
+ * Struct members:
+ * - `writing`: Whether an update is in progress
+ * - `source`: Where the action words for the new layout come from
+ * - `slot`: The index of the slot being written
+ * - `layer`, `row`: The next row of `data` to write.  `layer` is
+ *   `OPT__EEPROM_LAYOUT__LAYERS` once every row has been queued, and one more
+ *   than that once the rest of the slot has been.
+ * - `crc`: The CRC of the bytes queued so far (starting with `sequence`)
+ */
+static struct {
+    bool                    writing;
+    eeprom_layout__source_t source;
+    uint8_t                 slot;
+    uint8_t                 layer;
+    uint8_t                 row;
+    uint16_t                crc;
+} update;
+
+// ----------------------------------------------------------------------------
+
+/**                                             functions/read_word/description
+ * Read and return the word at `from` in the EEPROM memory space
+ */
+static uint16_t read_word(uint8_t from[2]) {
+    return eeprom__read(&from[0]) | (uint16_t) eeprom__read(&from[1]) << 8;
+}
+
+/**                                            functions/write_byte/description
+ * Schedule a write of `data` to `to` in the EEPROM memory space, and add it
+ * to `update.crc`
+ *
+ * Returns:
+ * - success: `0`
+ * - failure: [other]
+ */
+static uint8_t write_byte(uint8_t * to, uint8_t data) {
+    update.crc = _crc16_update(update.crc, data);
+    return eeprom__write(to, data);
+}
+
+/**                                                 functions/check/description
+ * Return whether the given slot is valid
+ *
+ * Returns:
+ * - `0`: if it's valid
+ * - [other]: if it isn't
+ *
+ * Notes:
+ * - Must not be called while writes to the slot are queued, or the bytes
+ *   read may not be the ones written.
+ */
+static uint8_t check(uint8_t slot) {
+    struct slot * s = &slots[slot];
+
+    if ( eeprom__read(&s->version) != VERSION
+         || eeprom__read(&s->layers)  != OPT__EEPROM_LAYOUT__LAYERS
+         || eeprom__read(&s->rows)    != OPT__KB__ROWS
+         || eeprom__read(&s->columns) != OPT__KB__COLUMNS )
+        return 1;
+
+    uint16_t crc = 0xFFFF;
+    for (uint8_t * p = &s->sequence; p < s->crc; p++)
+        crc = _crc16_update(crc, eeprom__read(p));
+
+    return crc != read_word(s->crc);
+}
+
+/**                                                  functions/load/description
+ * Copy the given (valid) slot into `layout`, and start using it
+ */
+static void load(uint8_t slot) {
+    struct slot * s = &slots[slot];
+
+    for (uint8_t l = 0; l < OPT__EEPROM_LAYOUT__LAYERS; l++)
+        for (uint8_t r = 0; r < OPT__KB__ROWS; r++)
+            for (uint8_t c = 0; c < OPT__KB__COLUMNS; c++)
+                layout[l][r][c] = read_word(s->data[l][r][c]);
+
+    active.slot     = slot;
+    active.sequence = eeprom__read(&s->sequence);
+    active.changes++;
+}
+
+/**                                            functions/write_step/description
+ * Queue the next part of the update in progress, once the EEPROM has caught
+ * up with the last part, and switch to the new slot once it's all been
+ * written
+ *
+ * Notes:
+ * - Only a row is queued at a time, to keep the EEPROM write queue short.
+ * - The slot is written in this order: `version = 0x00` (by
+ *   `eeprom_layout__update()`), `data`, the rest of the header, `crc`, and
+ *   (last) `version = VERSION`.
+ * - If anything can't be queued, the update is abandoned.  The slot being
+ *   written won't be valid, so this is safe.
+ */
+static void write_step(void * context) {
+    struct slot * s = &slots[update.slot];
+    uint8_t error = 0;
+
+    if (eeprom__is_writing()) {
+        // wait for the EEPROM to catch up
+
+    } else if (update.layer < OPT__EEPROM_LAYOUT__LAYERS) {
+        for (uint8_t c = 0; c < OPT__KB__COLUMNS && !error; c++) {
+            uint16_t action = (*update.source)(update.layer, update.row, c);
+            uint8_t * to = s->data[update.layer][update.row][c];
+
+            error = write_byte(&to[0], action & 0xFF)
+                 || write_byte(&to[1], action >> 8);
+        }
+
+        if (++update.row == OPT__KB__ROWS) {
+            update.row = 0;
+            update.layer++;
+        }
+
+    } else if (update.layer == OPT__EEPROM_LAYOUT__LAYERS) {
+        uint16_t crc = update.crc;  // (`data` was the last of it)
+
+        error = eeprom__write(&s->sequence, active.sequence + 1)
+             || eeprom__write(&s->layers,   OPT__EEPROM_LAYOUT__LAYERS)
+             || eeprom__write(&s->rows,     OPT__KB__ROWS)
+             || eeprom__write(&s->columns,  OPT__KB__COLUMNS)
+             || eeprom__write(&s->crc[0],   crc & 0xFF)
+             || eeprom__write(&s->crc[1],   crc >> 8)
+             || eeprom__write(&s->version,  VERSION);
+
+        update.layer++;
+
+    } else {
+        // everything's been written: check it, and switch to it
+        if (!check(update.slot))
+            load(update.slot);
+
+        update.writing = false;
+        return;
+    }
+
+    if (error || !timer__schedule_milliseconds(STEP_MS, &write_step, NULL))
+        update.writing = false;  // abandon the update
+}
+
+// ----------------------------------------------------------------------------
+
+uint8_t eeprom_layout__init(void) {
+    for (uint8_t l = 0; l < OPT__EEPROM_LAYOUT__LAYERS; l++)
+        for (uint8_t r = 0; r < OPT__KB__ROWS; r++)
+            for (uint8_t c = 0; c < OPT__KB__COLUMNS; c++)
+                layout[l][r][c] = EEPROM_LAYOUT__NONE;
+
+    bool valid[2] = { !check(0), !check(1) };
+
+    if (valid[0] && valid[1]) {
+        // the most recent, allowing for the sequence numbers to wrap
+        int8_t newer = eeprom__read(&slots[1].sequence)
+                     - eeprom__read(&slots[0].sequence);
+        load( (newer > 0) ? 1 : 0 );
+    } else if (valid[0]) {
+        load(0);
+    } else if (valid[1]) {
+        load(1);
+    } else {
+        return 1;  // no valid slot
+    }
+
+    return 0;  // success
+}
+
+uint16_t eeprom_layout__get(uint8_t layer, uint8_t row, uint8_t column) {
+    if (layer >= OPT__EEPROM_LAYOUT__LAYERS)
+        return EEPROM_LAYOUT__NONE;
+
+    return layout[layer][row][column];
+}
+
+uint8_t eeprom_layout__update(eeprom_layout__source_t source) {
+    if (update.writing)
+        return 1;  // an update is already in progress
+
+    update.source = source;
+    update.slot   = (active.slot == 0) ? 1 : 0;
+    update.layer  = 0;
+    update.row    = 0;
+
+    // the header, in the order it's stored (`data` is added as it's written)
+    update.crc = 0xFFFF;
+    update.crc = _crc16_update(update.crc, active.sequence + 1);
+    update.crc = _crc16_update(update.crc, OPT__EEPROM_LAYOUT__LAYERS);
+    update.crc = _crc16_update(update.crc, OPT__KB__ROWS);
+    update.crc = _crc16_update(update.crc, OPT__KB__COLUMNS);
+
+    // invalidate the slot first, so that it's never valid half written
+    if (eeprom__write(&slots[update.slot].version, 0x00))
+        return 2;  // write failed
+    if (!timer__schedule_milliseconds(STEP_MS, &write_step, NULL))
+        return 3;  // couldn't schedule the update
+
+    update.writing = true;
+    return 0;  // success
+}
+
+bool eeprom_layout__is_writing(void) {
+    return update.writing;
+}
+
+uint8_t eeprom_layout__changes(void) {
+    return active.changes;
+}
+
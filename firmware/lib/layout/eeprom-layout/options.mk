@@ -0,0 +1,22 @@
+# -----------------------------------------------------------------------------
+# Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+# Released under The MIT License (see "doc/licenses/MIT.md")
+# Project located at <https://github.com/benblazak/ergodox-firmware>
+# -----------------------------------------------------------------------------
+
+##                                                                  description
+# eeprom-layout options
+#
+# This file is meant to be included by the using '.../options.mk'
+#
+
+
+$(call include_options_once,lib/eeprom)
+$(call include_options_once,lib/timer)
+
+SRC += $(wildcard $(CURDIR)/$(MCU).c)
+
+ifeq '$(MCU)' 'host'
+	SRC += $(wildcard $(CURDIR)/$(EMULATED_MCU).c)
+endif
+
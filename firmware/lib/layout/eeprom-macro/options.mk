@@ -13,3 +13,7 @@
 
 SRC += $(wildcard $(CURDIR)/$(MCU).c)
 
+ifeq '$(MCU)' 'host'
+	SRC += $(wildcard $(CURDIR)/$(EMULATED_MCU).c)
+endif
+
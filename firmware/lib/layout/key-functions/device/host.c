@@ -0,0 +1,21 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * Implements the "device" section of "../../key-functions.h" for host builds
+ */
+
+
+#include <stdio.h>
+#include "../../../host.h"
+#include "../../key-functions.h"
+
+// ----------------------------------------------------------------------------
+
+void key_functions__jump_to_bootloader(void) {
+    printf("# jump to bootloader\n");
+    host__exit();
+}
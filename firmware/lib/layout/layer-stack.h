@@ -20,6 +20,7 @@
 // ----------------------------------------------------------------------------
 
 
+#include <stdbool.h>
 #include <stdint.h>
 
 // ----------------------------------------------------------------------------
@@ -33,6 +34,10 @@ uint8_t layer_stack__find_id (uint8_t layer_id);
 uint8_t layer_stack__size    (void);
 uint8_t layer_stack__reset   (void);
 
+bool    layer_stack__is_active (uint8_t layer_number);
+uint8_t layer_stack__highest   (void);
+uint8_t layer_stack__changes   (void);
+
 
 // ----------------------------------------------------------------------------
 // ----------------------------------------------------------------------------
@@ -72,7 +77,8 @@ uint8_t layer_stack__reset   (void);
  *
  * Returns:
  * - success: the `offset` of the element that was pushed (or updated)
- * - failure: `UINT8_MAX`
+ * - failure: `UINT8_MAX` (e.g. if the stack is full, or `layer_number` is out
+ *   of bounds)
  *
  * Notes:
  * - If the given layer-id is not present in the stack, and a new element is
@@ -116,3 +122,58 @@ uint8_t layer_stack__reset   (void);
  * - success: the current size (height) of the layer-stack (`0` if empty)
  */
 
+// === layer_stack__reset() ===
+/**                                    functions/layer_stack__reset/description
+ * Remove every element from the layer-stack
+ *
+ * Returns:
+ * - success: `0`
+ */
+
+// === layer_stack__is_active() ===
+/**                                functions/layer_stack__is_active/description
+ * Return whether the given layer-number is in the layer-stack
+ *
+ * Arguments:
+ * - `layer_number`: the layer-number to look for
+ *
+ * Returns:
+ * - `true` if an element with the given layer-number is in the layer-stack,
+ *   or if `layer_number` is `0` (the default layer, which is always under the
+ *   stack); `false` otherwise
+ *
+ * Notes:
+ * - Takes constant time (this doesn't search the stack).
+ */
+
+// === layer_stack__highest() ===
+/**                                  functions/layer_stack__highest/description
+ * Return the highest layer-number in the layer-stack
+ *
+ * Returns:
+ * - success: the highest layer-number of any element in the layer-stack (`0`
+ *   if the stack is empty)
+ *
+ * Notes:
+ * - Takes constant time (this doesn't search the stack).
+ * - This is the highest active layer-number, not necessarily the layer-number
+ *   on top of the stack (see `layer_stack__peek()` for that).
+ */
+
+// === layer_stack__changes() ===
+/**                                  functions/layer_stack__changes/description
+ * Return the number of times the layer-stack has changed (mod 2^8)
+ *
+ * Returns:
+ * - success: the number of changes so far (mod 2^8); if this is the same as
+ *   it was before, the layer-stack hasn't changed in between (unless it
+ *   changed a multiple of 256 times)
+ *
+ * Notes:
+ * - Meant for code that keeps something worked out from the layer-stack
+ *   (e.g. which layer each key resolves to), to know when to work it out
+ *   again.
+ * - Every successful push, pop, and reset counts as a change (even if it
+ *   doesn't change which layers are active).
+ */
+
@@ -8,39 +8,56 @@
  * Implements the layer-stack defined in "../layer-stack.h"
  *
  * Notes:
- * - This would be relatively trivial to implement using linked lists; but
- *   while I'm sure it takes more PROGMEM to do it this way, it uses less SRAM,
- *   and is also probably faster on average.  I also think it's a nice example
- *   of how to resize arrays in C based on demand.  I tried to generalize the
- *   functionality a little into a "flex-array" for "lib/data-types", in order
- *   to make the same technique easier to use elsewhere.  It turns out though
- *   that doing this in a type-agnostic way leads to passing an inordinate
- *   amount of information on the call stack for each function call (array
- *   size, element size, ..., ...), which for small stacks defeats the purpose
- *   (of saving SRAM), and is kind of inefficient and ugly anyway.  But
- *   sacrificing a bit of PROGMEM (and programmer time) to reimplement this
- *   everywhere it's used seems worth it, since the amount of core code that
- *   would be able to be generalized out anyway is relatively small and
- *   straightforward.
+ * - The stack lives in a fixed size array, so nothing is allocated at
+ *   runtime.  It used to be kept in an array resized with `realloc()` on
+ *   every push and pop, to save SRAM; but the stack is only ever a few
+ *   elements deep, so a fixed array doesn't cost much, and `malloc()` has
+ *   costs of its own (2 bytes per allocation, the code to manage the heap,
+ *   and the time it takes).
+ * - Alongside the stack, we keep a bitmask of the layer-numbers in it (and
+ *   the highest one), so that they can be looked up without searching the
+ *   stack.  These are worked out again (by walking the stack) whenever the
+ *   stack changes, which costs about as much as the shifting that pushing and
+ *   popping already have to do.
  */
 
 
 #include <stdbool.h>
 #include <stdint.h>
-#include <stdlib.h>
 #include "../layer-stack.h"
 
 // ----------------------------------------------------------------------------
 
-/**                                               macros/MIN_UNUSED/description
- * The minimum number of elements to have unused after a resize
+#ifndef OPT__LAYER_STACK__SIZE
+    #error "OPT__LAYER_STACK__SIZE not defined"
+#endif
+/**                                   macros/OPT__LAYER_STACK__SIZE/description
+ * The maximum number of elements the layer-stack may hold
+ *
+ * Notes:
+ * - Must be less than `255` (see `stack`).
+ * - Each element takes 2 bytes of SRAM.  Pushing an element when the stack
+ *   is full fails.
  */
-#define  MIN_UNUSED  0
-
-/**                                               macros/MAX_UNUSED/description
- * The maximum number of elements to have unused after a resize
+#if OPT__LAYER_STACK__SIZE >= 255
+    #error "OPT__LAYER_STACK__SIZE is too large"
+#endif
+
+#ifndef OPT__LAYER_STACK__LAYERS
+    #error "OPT__LAYER_STACK__LAYERS not defined"
+#endif
+/**                                 macros/OPT__LAYER_STACK__LAYERS/description
+ * The number of layer-numbers that may be used (layer-numbers must be less
+ * than this)
+ *
+ * Notes:
+ * - Should be at least the number of layers in the keyboard layout.
+ * - Must be at most `255`.  Each 8 layers takes 1 byte of SRAM (for the
+ *   bitmask of active layers).
  */
-#define  MAX_UNUSED  4
+#if OPT__LAYER_STACK__LAYERS > 255
+    #error "OPT__LAYER_STACK__LAYERS is too large"
+#endif
 
 // ----------------------------------------------------------------------------
 
@@ -62,78 +79,60 @@ typedef struct {
  * To hold the layer-stack and directly related metadata
  *
  * Struct members:
- * - `allocated`:  The number of positions allocated
  * - `filled`: The number of positions filled
- * - `data`: A pointer to the array of layer-elements
+ * - `changes`: The number of times the stack has changed (mod 2^8)
+ * - `highest`: The highest layer-number in the stack (`0` if it's empty)
+ * - `active`: A bitmask of the layer-numbers in the stack (bit `n%8` of
+ *   `active[n/8]` is set if layer `n` is in the stack)
+ * - `data`: The layer-elements, with the top of the stack at
+ *   `data[filled-1]`
  *
  * Notes:
- * - The maximum value of `uint8_t filled` is `UINT8_MAX` indicating a stack
- *   with `UINT8_MAX` elements.  This means that any valid offset or index will
- *   be between `0` and `UINT8_MAX-1` inclusive, and that `UINT8_MAX` will
+ * - `filled` is always less than `UINT8_MAX`, so any valid offset or index
+ *   will be between `0` and `UINT8_MAX-1` inclusive, and `UINT8_MAX` will
  *   therefore always be an invalid value for an offset or index.
  */
 static struct {
-    uint8_t allocated;
-    uint8_t filled;
-    element_t * data;
+    uint8_t   filled;
+    uint8_t   changes;
+    uint8_t   highest;
+    uint8_t   active[(OPT__LAYER_STACK__LAYERS+7)/8];
+    element_t data[OPT__LAYER_STACK__SIZE];
 } stack;
 
 // ----------------------------------------------------------------------------
 
-/**                                          functions/resize_stack/description
- * Resize the stack, so that the number of unused elements is between
- * `MIN_UNUSED` and `MAX_UNUSED`, inclusive
- *
- * Returns:
- * - success: `0`
- * - failure: [other]
- *
- * Implementation notes:
- * - We use a signed type for `unused` in case `filled` is greater than
- *   `allocated`, as may happen when pushing a new element onto the stack.
- *   This number should normally be much smaller than either `filled` or
- *   `allocated`, so we don't need to worry about the maximum value being 2^7-1
- *   instead of 2^8-1.
- * - The only time `realloc()` should fail is if we are trying to grow the
- *   stack.  See [the documentation]
- *   (http://www.nongnu.org/avr-libc/user-manual/malloc.html)
- *   for `malloc()` in avr-libc.
+/**                                         functions/update_active/description
+ * Work out `stack.active` and `stack.highest` again, from the elements in the
+ * stack (and count a change)
  */
-static uint8_t resize_stack(void) {
-    int8_t unused = stack.allocated - stack.filled;
-
-    if (MIN_UNUSED <= unused && unused <= MAX_UNUSED)
-        return 0;  // nothing to do
-
-    uint8_t new_allocated;
-    if (UINT8_MAX >= stack.filled + (MIN_UNUSED+MAX_UNUSED)/2)
-        new_allocated = stack.filled + (MIN_UNUSED+MAX_UNUSED)/2;
-    else if (UINT8_MAX >= stack.filled + MIN_UNUSED)
-        new_allocated = UINT8_MAX;
-    else
-        return 1;  // unable to count the required number of elements
-
-    void * new_data = realloc( stack.data, sizeof(element_t) * new_allocated );
-    if (!new_data)
-        return 1;  // error: `realloc()` failed (unable to grow stack)
-
-    stack.allocated = new_allocated;
-    stack.data = new_data;
-
-    return 0;  // success
+static void update_active(void) {
+    stack.changes++;
+
+    for (uint8_t i = 0; i < sizeof(stack.active); i++)
+        stack.active[i] = 0;
+    stack.highest = 0;
+
+    for (uint8_t i = 0; i < stack.filled; i++) {
+        uint8_t number = stack.data[i].number;
+        stack.active[number/8] |= 1 << (number%8);
+        if (number > stack.highest)
+            stack.highest = number;
+    }
 }
 
 // ----------------------------------------------------------------------------
 
 uint8_t layer_stack__reset() {
-  stack.filled = 0;
-  return resize_stack();
+    stack.filled = 0;
+    update_active();
+    return 0;  // success
 }
 
 // ----------------------------------------------------------------------------
 
 uint8_t layer_stack__peek(uint8_t offset) {
-    if (offset > stack.filled-1)
+    if (offset >= stack.filled)
         return 0;  // default
 
     return stack.data[stack.filled-1-offset].number;
@@ -143,24 +142,26 @@ uint8_t layer_stack__push( uint8_t offset,
                            uint8_t layer_id,
                            uint8_t layer_number ) {
 
+    if (layer_number >= OPT__LAYER_STACK__LAYERS)
+        return UINT8_MAX;  // error: layer-number out of bounds
+
     // if an element with the given layer-id already exists
     {
         uint8_t old_offset = layer_stack__find_id(layer_id);
         if (old_offset != UINT8_MAX) {
             stack.data[stack.filled-1-old_offset].number = layer_number;
+            update_active();
             return old_offset;
         }
     }
 
     // add an element
-    if (stack.filled == UINT8_MAX)
+    if (stack.filled == OPT__LAYER_STACK__SIZE)
         return UINT8_MAX;  // error: stack already full
+    if (offset > stack.filled)
+        return UINT8_MAX;  // error: index out of bounds
     stack.filled++;
     uint8_t index = stack.filled-1-offset;
-    if (index > stack.filled-1 || resize_stack()) {
-        stack.filled--;
-        return UINT8_MAX;  // error: index out of bounds, or resize failed
-    }
 
     // shift up
     // - start with the top element (which is currently uninitialized), and
@@ -175,6 +176,11 @@ uint8_t layer_stack__push( uint8_t offset,
     stack.data[index].id = layer_id;
     stack.data[index].number = layer_number;
 
+    stack.changes++;
+    stack.active[layer_number/8] |= 1 << (layer_number%8);
+    if (layer_number > stack.highest)
+        stack.highest = layer_number;
+
     return offset;  // success
 }
 
@@ -196,7 +202,7 @@ uint8_t layer_stack__pop_id(uint8_t layer_id) {
 
     // remove an element
     stack.filled--;
-    resize_stack();  // we're shrinking the stack, so this should never fail
+    update_active();
 
     return offset;  // success
 }
@@ -212,3 +218,19 @@ uint8_t layer_stack__size(void) {
     return stack.filled;
 }
 
+bool layer_stack__is_active(uint8_t layer_number) {
+    if (layer_number >= OPT__LAYER_STACK__LAYERS)
+        return false;
+
+    return !layer_number
+        || ( stack.active[layer_number/8] & (1 << (layer_number%8)) );
+}
+
+uint8_t layer_stack__highest(void) {
+    return stack.highest;
+}
+
+uint8_t layer_stack__changes(void) {
+    return stack.changes;
+}
+
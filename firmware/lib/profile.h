@@ -0,0 +1,182 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * Scan cycle profiler interface
+ *
+ * Prefixes: `profile__`, `profile___`
+ *
+ * Measures how many CPU cycles each phase of the main loop takes, and keeps
+ * the minimum, maximum, and (recent) average for each phase in
+ * `profile__stats`, where they may be inspected with a debugger, or in the
+ * simulation (`make host` prints them in its summary).
+ *
+ * The profiler is only compiled in if `PROFILE_ENABLE` is defined (see
+ * ".../firmware/lib/profile/options.mk").  Otherwise, the macros below expand
+ * to nothing, and `profile__stats` does not exist.
+ */
+
+
+#ifndef ERGODOX_FIRMWARE__LIB__PROFILE__H
+#define ERGODOX_FIRMWARE__LIB__PROFILE__H
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+
+#include <stdint.h>
+
+// ----------------------------------------------------------------------------
+
+#define  PROFILE__TEENSY     0
+#define  PROFILE__MCP23018   1
+#define  PROFILE__DEBOUNCE   2
+#define  PROFILE__EXEC_KEYS  3
+#define  PROFILE__USB        4
+#define  PROFILE__LEDS       5
+#define  PROFILE__TICK       6
+
+#define  PROFILE__PHASES     7
+
+// ----------------------------------------------------------------------------
+
+#ifdef PROFILE_ENABLE
+
+    struct profile__phase {
+        uint16_t min;
+        uint16_t max;
+        uint32_t total;
+    };
+
+    struct profile__stats {
+        uint16_t count;
+        struct profile__phase phase[PROFILE__PHASES];
+    };
+
+    extern struct profile__stats profile__stats;
+
+    void profile___init  (void);
+    void profile___start (void);
+    void profile___mark  (uint8_t phase);
+
+    #define  profile__init()        profile___init()
+    #define  profile__start()       profile___start()
+    #define  profile__mark(phase)   profile___mark(phase)
+
+#else
+
+    #define  profile__init()        ((void)0)
+    #define  profile__start()       ((void)0)
+    #define  profile__mark(phase)   ((void)0)
+
+#endif
+
+
+// ----------------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+#endif  // ERGODOX_FIRMWARE__LIB__PROFILE__H
+
+
+
+// ============================================================================
+// === documentation ==========================================================
+// ============================================================================
+
+
+// ----------------------------------------------------------------------------
+// macros ---------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+// === (group) phases ===
+/**                                           macros/(group) phases/description
+ * The phases of a scan cycle
+ *
+ * Members:
+ * - `PROFILE__TEENSY`: Finishing the scan of the right half (the part that
+ *   didn't fit in the gaps while the left half was waiting on the bus)
+ * - `PROFILE__MCP23018`: Scanning the left half (`mcp23018__update_matrix()`),
+ *   with the right half being scanned in the gaps
+ * - `PROFILE__DEBOUNCE`: `debounce__update()`
+ * - `PROFILE__EXEC_KEYS`: Finding the keys that changed, and executing them
+ * - `PROFILE__USB`: Sending the keyboard report
+ * - `PROFILE__LEDS`: Updating the LEDs
+ * - `PROFILE__TICK`: `timer___tick_cycles()` and
+ *   `timer___tick_milliseconds()`, and anything they run
+ *
+ * - `PROFILE__PHASES`: The number of phases
+ */
+
+// === profile__init() ===
+/**                                            macros/profile__init/description
+ * Start the hardware timer, and clear `profile__stats`
+ *
+ * Notes:
+ * - Should be called once by `main()`, before the main loop.
+ */
+
+// === profile__start() ===
+/**                                           macros/profile__start/description
+ * Note that a scan cycle is starting
+ *
+ * Notes:
+ * - Time passed since the last mark (i.e. time spent asleep) is not counted.
+ */
+
+// === profile__mark() ===
+/**                                            macros/profile__mark/description
+ * Note that the given phase has just ended
+ *
+ * Arguments:
+ * - `phase`: The phase (see the "phases" group, above)
+ *
+ * Notes:
+ * - The phase is assumed to have started at the last call to
+ *   `profile__start()` or `profile__mark()`.
+ * - Phases longer than `UINT16_MAX` cycles (about 4.1 ms at 16 MHz) are
+ *   recorded as `UINT16_MAX`.
+ * - The profiler's own overhead (a few dozen cycles per mark) is counted as
+ *   part of the next phase.
+ */
+
+
+// ----------------------------------------------------------------------------
+// types ----------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+// === profile__phase ===
+/**                                     types/struct profile__phase/description
+ * Statistics for one phase of the scan cycle, in CPU cycles
+ *
+ * Struct members:
+ * - `min`: The shortest time the phase has taken
+ * - `max`: The longest time the phase has taken
+ * - `total`: The total time the phase has taken, over the last
+ *   `profile__stats.count` scan cycles
+ */
+
+// === profile__stats ===
+/**                                     types/struct profile__stats/description
+ * Statistics for every phase of the scan cycle
+ *
+ * Struct members:
+ * - `count`: The number of scan cycles `total`s were accumulated over
+ * - `phase`: The statistics for each phase, indexed by phase
+ *
+ * Notes:
+ * - The average time a phase takes is `total / count`.  To keep `total` from
+ *   overflowing, `count` and every `total` are halved whenever `count` reaches
+ *   1024, so the average is over the last 512 to 1024 scan cycles.
+ */
+
+
+// ----------------------------------------------------------------------------
+// variables ------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+// === profile__stats ===
+/**                                        variables/profile__stats/description
+ * The statistics collected so far
+ */
+
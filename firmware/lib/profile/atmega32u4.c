@@ -0,0 +1,75 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * Implements the profiler defined in ".../firmware/lib/profile.h" for the
+ * ATMega32U4
+ *
+ * Notes:
+ * - Uses Timer/Counter 3 (which nothing else uses), in normal mode, with no
+ *   prescaling: `TCNT3` counts CPU cycles.  The counter is reset at every
+ *   mark, and its overflow flag tells us if a phase took too long to measure.
+ */
+
+
+#include <stdint.h>
+#include <avr/io.h>
+#include "../../../firmware/lib/profile.h"
+
+// ----------------------------------------------------------------------------
+
+#if F_CPU != 16000000
+    #error "Expecting different CPU frequency"
+#endif
+
+// ----------------------------------------------------------------------------
+
+/**                                                 macros/MAX_COUNT/description
+ * The number of scan cycles at which `count` and every `total` are halved
+ */
+#define  MAX_COUNT  1024
+
+// ----------------------------------------------------------------------------
+
+struct profile__stats profile__stats;
+
+// ----------------------------------------------------------------------------
+
+void profile___init(void) {
+    for (uint8_t i = 0; i < PROFILE__PHASES; i++)
+        profile__stats.phase[i] = (struct profile__phase){ .min = UINT16_MAX };
+    profile__stats.count = 0;
+
+    TCCR3A = 0;           // normal mode
+    TCCR3B = (1<<CS30);   // clk_i/o, no prescaling
+}
+
+void profile___start(void) {
+    if (++profile__stats.count == MAX_COUNT) {
+        profile__stats.count /= 2;
+        for (uint8_t i = 0; i < PROFILE__PHASES; i++)
+            profile__stats.phase[i].total /= 2;
+    }
+
+    TCNT3 = 0;
+    TIFR3 = (1<<TOV3);  // (cleared by writing a `1`)
+}
+
+void profile___mark(uint8_t phase) {
+    uint16_t cycles = TCNT3;
+    TCNT3 = 0;
+
+    if (TIFR3 & (1<<TOV3)) {
+        cycles = UINT16_MAX;
+        TIFR3 = (1<<TOV3);
+    }
+
+    struct profile__phase * p = &profile__stats.phase[phase];
+    if (cycles < p->min) p->min = cycles;
+    if (cycles > p->max) p->max = cycles;
+    p->total += cycles;
+}
+
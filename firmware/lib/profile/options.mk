@@ -0,0 +1,28 @@
+# -----------------------------------------------------------------------------
+# Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+# Released under The MIT License (see "doc/licenses/MIT.md")
+# Project located at <https://github.com/benblazak/ergodox-firmware>
+# -----------------------------------------------------------------------------
+
+##                                                                  description
+# profiler options
+#
+# This file is meant to be included by '.../firmware/makefile'
+#
+# Notes:
+# - The profiler is only compiled in if `PROFILE_ENABLE` is set (e.g. `make
+#   PROFILE_ENABLE=true`, or `make host PROFILE_ENABLE=true`)
+#
+
+
+ifdef PROFILE_ENABLE
+
+CFLAGS += -DPROFILE_ENABLE
+
+SRC += $(wildcard $(CURDIR)/$(MCU).c)
+
+ifeq '$(MCU)' 'host'
+	SRC += $(wildcard $(CURDIR)/$(EMULATED_MCU).c)
+endif
+
+endif
@@ -35,7 +35,7 @@
  *          32         4294967295    4294967.3    71582.8    1193.0    49.7
  *     ---------------------------------------------------------------------
  *
- *     note: 32-bit values given for reference only
+ *     note: only the millisecond (and microsecond) timers keep 32 bits
  */
 
 
@@ -45,20 +45,45 @@
 // ----------------------------------------------------------------------------
 
 
+#include <stdint.h>
+
+// ----------------------------------------------------------------------------
+
+typedef uint16_t timer__handle_t;
+
+// ----------------------------------------------------------------------------
+
 uint8_t  timer__init             (void);
 
 uint16_t timer__get_cycles       (void);
 uint16_t timer__get_keypresses   (void);
-uint16_t timer__get_milliseconds (void);
+uint32_t timer__get_milliseconds (void);
+uint32_t timer__get_microseconds (void);
+uint16_t timer__get_overflows    (void);
+
+timer__handle_t timer__schedule_cycles       ( uint16_t ticks,
+                                               void(*function)(void *),
+                                               void *   context );
+timer__handle_t timer__schedule_keypresses   ( uint16_t ticks,
+                                               void(*function)(void *),
+                                               void *   context );
+timer__handle_t timer__schedule_milliseconds ( uint16_t ticks,
+                                               void(*function)(void *),
+                                               void *   context );
 
-uint8_t  timer__schedule_cycles       (uint16_t ticks, void(*function)(void));
-uint8_t  timer__schedule_keypresses   (uint16_t ticks, void(*function)(void));
+uint8_t  timer__cancel     (timer__handle_t handle);
+uint8_t  timer__reschedule (timer__handle_t handle, uint16_t ticks);
+
+uint8_t  timer__get_scan_period (void);
+void     timer__set_scan_period (uint8_t milliseconds);
+void     timer__wait_for_scan   (void);
 
 // ----------------------------------------------------------------------------
 // private
 
 void timer___tick_cycles       (void);
 void timer___tick_keypresses   (void);
+void timer___tick_milliseconds (void);
 
 
 // ----------------------------------------------------------------------------
@@ -72,6 +97,24 @@ void timer___tick_keypresses   (void);
 // ============================================================================
 
 
+// ----------------------------------------------------------------------------
+// types ----------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+// === timer__handle_t ===
+/**                                           types/timer__handle_t/description
+ * A reference to a scheduled event, which may be used to cancel or
+ * reschedule it
+ *
+ * Notes:
+ * - `0` is never a valid handle.
+ * - A handle stops referring to its event once the event starts running, or
+ *   is canceled.  Using it after that fails harmlessly, even if the memory
+ *   that held the event has been reused (unless it's been reused 255 times
+ *   since, which is unlikely, since the event pool is small).
+ */
+
+
 // ----------------------------------------------------------------------------
 // functions ------------------------------------------------------------------
 // ----------------------------------------------------------------------------
@@ -91,15 +134,28 @@ void timer___tick_keypresses   (void);
 // === (group) get ===
 /**                                           functions/(group) get/description
  * Return the number of "ticks" since the given timer was initialized
- * (mod 2^16)
+ * (mod 2^16, or for the real time timers, mod 2^32)
  *
  * Members:
  * - `timer__get_cycles`: Counts the number of scan cycles
  * - `timer__get_keypresses`: Counts the number of applicable key presses
- * - `timer__get_milliseconds`: Counts real time milliseconds
+ * - `timer__get_milliseconds`: Counts real time milliseconds (wraps after
+ *   about 49.7 days)
+ * - `timer__get_microseconds`: Counts real time microseconds (wraps after
+ *   about 71.6 minutes), with the resolution of the hardware timer (4
+ *   microseconds on the ATMega32U4)
  *
  * Returns:
- * - success: The number of "ticks" since the timer was initialized (mod 2^16)
+ * - success: The number of "ticks" since the timer was initialized (mod 2^16,
+ *   or 2^32)
+ *
+ * Notes:
+ * - The real time counters are kept by an interrupt, but are always read
+ *   whole (with interrupts disabled as necessary), so a value is never torn
+ *   between the bytes from before and after an update.  The two counters
+ *   agree: `timer__get_microseconds() / 1000` is the millisecond count.
+ * - Reading the 32-bit counters costs a little more than the 16-bit ones.
+ *   Store them in a smaller variable if you don't need the range (see below).
  *
  *
  * Usage notes:
@@ -151,6 +207,15 @@ void timer___tick_keypresses   (void);
  *   except within the first 2^8 milliseconds of the timer being initialized.
  */
 
+// === timer__get_overflows() ===
+/**                                  functions/timer__get_overflows/description
+ * Return the number of events that couldn't be scheduled, because too many
+ * were already waiting (see `OPT__TIMER__EVENTS`)
+ *
+ * Notes:
+ * - Stops counting at `UINT16_MAX`.
+ */
+
 // === (group) schedule ===
 /**                                      functions/(group) schedule/description
  * Schedule `function` to run in the given number of "ticks"
@@ -158,18 +223,39 @@ void timer___tick_keypresses   (void);
  * Members:
  * - `timer__schedule_cycles`
  * - `timer__schedule_keypresses`
+ * - `timer__schedule_milliseconds`
  *
  * Arguments:
  * - `ticks`: The number of ticks to wait
  * - `function`: A pointer to the function to run
+ * - `context`: The argument to pass to `function` (may be anything, including
+ *   `NULL`)
  *
  * Returns:
- * - success: `0`
- * - failure: [other]
+ * - success: A handle to the event (see `timer__handle_t`)
+ * - failure: `0`
  *
  *
  * Usage notes:
  *
+ * - An event scheduled for `0` ticks runs at the next tick; one scheduled for
+ *   `n` ticks, at the `n+1`th.  Events due at the same tick run in the order
+ *   they were scheduled.  An event may schedule itself, or others, but never
+ *   runs at the tick it was scheduled in.
+ *
+ * - Scheduling fails if `OPT__TIMER__EVENTS` events are already waiting
+ *   (across all timers).
+ *
+ * - Milliseconds are counted by the hardware timer, but the events are run
+ *   from the main loop (see `timer___tick_milliseconds()`), so they may run
+ *   up to a scan cycle late.  Since the count may be just about to change
+ *   when an event is scheduled, an event scheduled for `n` milliseconds runs
+ *   after at least `n-1` (and, if it's on time, at most `n`) real
+ *   milliseconds.  Use this timer for anything that should take a fixed
+ *   amount of real time, whatever the scan period is.
+ *
+ * - None of these may be called from an interrupt.
+ *
  * - If a function needs a longer wait time than is possible with a 16-bit
  *   resolution counter, it can repeatedly schedule itself to run in, say, 1
  *   minute (= 1000*60/5 cycles, assuming cycles take on average 5
@@ -178,6 +264,77 @@ void timer___tick_keypresses   (void);
  *   delay).
  */
 
+// === timer__cancel() ===
+/**                                         functions/timer__cancel/description
+ * Keep a scheduled event from running
+ *
+ * Arguments:
+ * - `handle`: The handle returned when the event was scheduled
+ *
+ * Returns:
+ * - success: `0`
+ * - failure: [other] (the event has already run (or started to), or been
+ *   canceled)
+ *
+ * Notes:
+ * - Events that are due at the current tick, but haven't run yet, may still
+ *   be canceled (e.g. by another event due at the same tick).
+ */
+
+// === timer__reschedule() ===
+/**                                     functions/timer__reschedule/description
+ * Change when a scheduled event will run
+ *
+ * Arguments:
+ * - `handle`: The handle returned when the event was scheduled
+ * - `ticks`: The number of ticks to wait, from now (as for the schedule
+ *   functions, on the same timer as before)
+ *
+ * Returns:
+ * - success: `0` (the handle stays valid)
+ * - failure: [other] (as for `timer__cancel()`)
+ *
+ * Notes:
+ * - The event runs after any others already due at the same tick.
+ * - To run an event again once it has started running, schedule it again.
+ */
+
+// === (group) scan period ===
+/**                                   functions/(group) scan period/description
+ * Get or set the number of milliseconds between the start of one scan cycle
+ * and the start of the next
+ *
+ * Members:
+ * - `timer__get_scan_period`
+ * - `timer__set_scan_period`
+ *
+ * Arguments:
+ * - `milliseconds`: The new period (values less than `1` are treated as `1`)
+ *
+ * Returns:
+ * - success: The current period, in milliseconds
+ *
+ * Notes:
+ * - The period may be changed at any time.  The next scan will start one full
+ *   (new) period after the call.
+ * - Before it is set, the period is `1` millisecond.
+ */
+
+// === timer__wait_for_scan() ===
+/**                                  functions/timer__wait_for_scan/description
+ * Wait (with the CPU asleep, if possible) until it's time to start the next
+ * scan cycle
+ *
+ * Meant to be used only by `main()`, once per cycle
+ *
+ * Notes:
+ * - Scan cycles start at fixed intervals of the scan period, measured by the
+ *   hardware timer, not from the end of the previous cycle; so the time taken
+ *   by a cycle does not affect when the next one starts.
+ * - If a cycle takes longer than the period, this function returns
+ *   immediately (once), and later cycles stay on the original schedule.
+ */
+
 // ----------------------------------------------------------------------------
 // private
 
@@ -196,3 +353,15 @@ void timer___tick_keypresses   (void);
  * Meant to be used only by `kb__layout__exec_key()`
  */
 
+// === timer___tick_milliseconds() ===
+/**                             functions/timer___tick_milliseconds/description
+ * Perform the tasks scheduled for any of the milliseconds that have passed
+ * since the last call
+ *
+ * Meant to be used only by `main()`, once per cycle
+ *
+ * Notes:
+ * - Doesn't increment the counter: `timer__get_milliseconds()` is kept by
+ *   the hardware timer.
+ */
+
@@ -12,9 +12,12 @@
  */
 
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <avr/interrupt.h>
 #include <avr/io.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
 #include "../../timer.h"
 
 // ----------------------------------------------------------------------------
@@ -25,14 +28,49 @@
 
 // ----------------------------------------------------------------------------
 
+/**                                                  macros/TICK_US/description
+ * The number of microseconds per tick of Timer/Counter 0 (with the clock
+ * prescaled by 64)
+ */
+#define  TICK_US  4
+
+/**                                                 macros/MS_TICKS/description
+ * The number of ticks of Timer/Counter 0 per millisecond
+ */
+#define  MS_TICKS  (1000/TICK_US)
+
+// ----------------------------------------------------------------------------
+
+/**                                          variables/milliseconds/description
+ * Struct members:
+ * - `counter`: The number of milliseconds since `timer__init()` (mod 2^32)
+ *
+ * Notes:
+ * - Reading `counter` takes several instructions, so it must be done with
+ *   interrupts disabled, or the interrupt could change it halfway through.
+ */
 static struct {
-    volatile uint16_t counter;
+    volatile uint32_t counter;
 } milliseconds;
 
+/**                                                  variables/scan/description
+ * To keep track of when the next scan cycle should start
+ *
+ * Struct members:
+ * - `period`: The number of milliseconds between scan cycle starts
+ * - `elapsed`: The number of milliseconds since the last scan cycle was due
+ * - `due`: Whether a scan cycle is due, and hasn't been started yet
+ */
+static struct {
+    volatile uint8_t period;
+    volatile uint8_t elapsed;
+    volatile bool    due;
+} scan = { .period = 1 };
+
 // ----------------------------------------------------------------------------
 
 uint8_t timer__init(void) {
-    OCR0A  = 250;         // (ticks (of hardware timer) per millisecond)
+    OCR0A  = MS_TICKS-1;  // (counts `0` to `OCR0A`, then starts over)
     TCCR0A = 0b00000010;  // (configure Timer/Counter 0)
     TCCR0B = 0b00000011;  // (configure Timer/Counter 0)
 
@@ -41,11 +79,62 @@ uint8_t timer__init(void) {
     return 0;  // success
 }
 
-uint16_t timer__get_milliseconds(void) {
-    return milliseconds.counter;
+uint32_t timer__get_milliseconds(void) {
+    uint32_t counter;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        counter = milliseconds.counter;
+    }
+    return counter;
+}
+
+uint32_t timer__get_microseconds(void) {
+    uint32_t counter;
+    uint8_t  ticks;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        counter = milliseconds.counter;
+        ticks = TCNT0;
+        // if the timer has started over, but the interrupt hasn't counted
+        // the millisecond yet (because interrupts are disabled), count it
+        // - unless the timer started over after we read it (in which case
+        //   we read the last tick of the millisecond)
+        if ( (TIFR0 & (1<<OCF0A)) && ticks < MS_TICKS-1 )
+            counter++;
+    }
+    return counter * 1000 + ticks * TICK_US;
+}
+
+uint8_t timer__get_scan_period(void) {
+    return scan.period;
+}
+
+void timer__set_scan_period(uint8_t milliseconds) {
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        scan.period = milliseconds ? milliseconds : 1;
+        scan.elapsed = 0;
+    }
+}
+
+void timer__wait_for_scan(void) {
+    set_sleep_mode(SLEEP_MODE_IDLE);  // (timers and USB keep running)
+
+    cli();
+    while (!scan.due) {
+        sleep_enable();
+        sei();        // (the instruction after `sei` always executes before
+        sleep_cpu();  //   any interrupt, so we can't miss the wakeup)
+        sleep_disable();
+        cli();
+    }
+    scan.due = false;
+    sei();
 }
 
 ISR(TIMER0_COMPA_vect) {
     milliseconds.counter++;
+
+    if (++scan.elapsed >= scan.period) {
+        scan.elapsed = 0;
+        scan.due = true;
+    }
 }
 
@@ -0,0 +1,78 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * Implements the device specific portion of the timer interface defined in
+ * ".../firmware/lib/timer.h" for host builds
+ *
+ * Notes:
+ * - Milliseconds and microseconds are derived from simulated time.  Since the
+ *   firmware busy-waits on `timer__get_milliseconds()`, each call lets a
+ *   little simulated time pass (see `host__poll()`).
+ * - Simulated microseconds wrap at 2^32 (after about 71 minutes), so the
+ *   millisecond count does too; simulations are never that long.
+ * - Scan cycles start on a fixed grid of simulated time, as they would with
+ *   the hardware timer; time spent waiting for them is spent asleep.
+ */
+
+
+#include <stdint.h>
+#include "../../host.h"
+#include "../../timer.h"
+
+// ----------------------------------------------------------------------------
+
+static struct {
+    uint32_t started;  // (in microseconds)
+} milliseconds;
+
+static struct {
+    uint8_t  period;  // (in milliseconds)
+    uint32_t next;    // (in microseconds)
+} scan = { .period = 1 };
+
+// ----------------------------------------------------------------------------
+
+uint8_t timer__init(void) {
+    milliseconds.started = host__micros();
+    scan.next = milliseconds.started + scan.period * 1000UL;
+
+    return 0;  // success
+}
+
+uint32_t timer__get_milliseconds(void) {
+    host__poll();
+
+    return (host__micros() - milliseconds.started) / 1000;
+}
+
+uint32_t timer__get_microseconds(void) {
+    host__poll();
+
+    return host__micros() - milliseconds.started;
+}
+
+uint8_t timer__get_scan_period(void) {
+    return scan.period;
+}
+
+void timer__set_scan_period(uint8_t milliseconds) {
+    scan.period = milliseconds ? milliseconds : 1;
+    scan.next = host__micros() + scan.period * 1000UL;
+}
+
+void timer__wait_for_scan(void) {
+    int32_t remaining = scan.next - host__micros();
+
+    if (remaining > 0)
+        host__sleep_ns(remaining * 1000UL);
+
+    do  // (skip any scan starts we've missed entirely)
+        scan.next += scan.period * 1000UL;
+    while ((int32_t)(scan.next - host__micros()) <= 0);
+
+    host__matrix__scan_started();
+}
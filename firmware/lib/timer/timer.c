@@ -7,25 +7,71 @@
 /**                                                                 description
  * Implements the device agnostic portion of the timer interface defined in
  * ".../firmware/lib/timer.h"
+ *
+ * Notes:
+ * - Events are kept in a fixed pool, shared by all the timers, so nothing is
+ *   allocated at runtime.
+ * - Each timer keeps its events in a delta queue: a list sorted by when they
+ *   should run, where each event holds the number of ticks to wait *after*
+ *   the one before it.  So a tick only has to look at the front of the list:
+ *   it costs the same however many events are waiting, plus the cost of
+ *   running the ones that are due.  Scheduling an event walks the list, to
+ *   find its place.
+ * - The milliseconds timer is ticked by the hardware timer interrupt, but its
+ *   events are run from the main loop (`timer___tick_milliseconds()`), which
+ *   lets all the milliseconds that have passed since it last ran pass at
+ *   once.
  */
 
 
 #include <stdint.h>
-#include <stdlib.h>
 #include "../timer.h"
 
 // ----------------------------------------------------------------------------
 // macros ---------------------------------------------------------------------
 
-/**                                               macros/MIN_UNUSED/description
- * The minimum number of elements to have unused after a resize
+#ifndef OPT__TIMER__EVENTS
+    #error "OPT__TIMER__EVENTS not defined"
+#endif
+/**                                       macros/OPT__TIMER__EVENTS/description
+ * The maximum number of events that may be scheduled at once (across all
+ * timers)
+ *
+ * Notes:
+ * - Must be less than `255`.
+ * - Each event takes 9 bytes of RAM (on the ATMega32U4).  Scheduling an
+ *   event when they're all in use fails, and is counted (see
+ *   `timer__get_overflows()`).
+ */
+#if OPT__TIMER__EVENTS >= 255
+    #error "OPT__TIMER__EVENTS is too large"
+#endif
+
+/**                                                     macros/NONE/description
+ * The index that means "no event" (the first position in the pool, which is
+ * never used)
+ */
+#define  NONE  0
+
+/**                                            macros/(group) lists/description
+ * The values of `event_t.list`, besides the index of a timer (in `timers`)
+ *
+ * Members:
+ * - `DUE`: Added to the index of the event's timer, if the event is on that
+ *   timer's `due` list
+ * - `FREE`: The event isn't in use
  */
-#define  MIN_UNUSED  0
+#define  DUE   0x80
+#define  FREE  0xFF
 
-/**                                               macros/MAX_UNUSED/description
- * The maximum number of elements to have unused after a resize
+/**                                           macros/(group) timers/description
+ * The index of each timer in `timers`
  */
-#define  MAX_UNUSED  4
+#define  CYCLES        0
+#define  KEYPRESSES    1
+#define  MILLISECONDS  2
+
+#define  TIMERS  3
 
 // ----------------------------------------------------------------------------
 // types ----------------------------------------------------------------------
@@ -34,190 +80,391 @@
  * To hold an event that should be run at some point in the future
  *
  * Struct members:
- * - `ticks`: The number of units of time to wait until running this event
+ * - `ticks`: The number of units of time to wait, after the event before this
+ *   one (or, for the first event, from now), until running this event
+ * - `next`: The index of the next event in the list (or `NONE`)
+ * - `list`: Which list the event is on (see the "lists" group, above)
+ * - `generation`: The number of times the event has been handed out (mod
+ *   2^8, skipping `0`), so that handles to it from earlier times can be told
+ *   apart
  * - `function`: The event (the function to run)
+ * - `context`: The argument to pass to `function`
  */
 typedef struct {
     uint16_t ticks;
-    void (*function)(void);
+    uint8_t  next;
+    uint8_t  list;
+    uint8_t  generation;
+    void (*function)(void * context);
+    void *   context;
 } event_t;
 
-/**                                                    types/list_t/description
- * To hold a list of events, with corresponding metadata
- *
- * Struct members:
- * - `allocated`: The number of positions allocated
- * - `filled`: The number of positions filled
- * - `data`: A list of events to run at some point in the future
- */
-typedef struct {
-    uint8_t   allocated;
-    uint8_t   filled;
-    event_t * data;
-} list_t;
-
 /**                                                   types/timer_t/description
  * To hold all the variables needed by a timer
  *
  * Struct members:
  * - `counter`: How many "ticks" of this timer have occurred since it was
- *   initialized (mod 2^16)
- * - `scheduled`: The list of events to be eventually run by this timer, with
- *   corresponding metadata
- *
+ *   initialized (mod 2^16) (for `MILLISECONDS`: the value of
+ *   `timer__get_milliseconds()` when its events were last run)
+ * - `scheduled`: The index of the first event to be run by this timer (or
+ *   `NONE`)
+ * - `due`: The index of the first event taken off `scheduled` by the tick in
+ *   progress, and not yet run (or `NONE`)
  */
 typedef struct {
     uint16_t counter;
-    list_t   scheduled;
+    uint8_t  scheduled;
+    uint8_t  due;
 } timer_t;
 
+// ----------------------------------------------------------------------------
+// variables ------------------------------------------------------------------
+
+/**                                                  variables/pool/description
+ * The events, and their bookkeeping
+ *
+ * Struct members:
+ * - `event`: Every event, whether in use or not (`event[NONE]` is never
+ *   used)
+ * - `unused`: The index of the last event that has been used (events are
+ *   handed out in order, the first time around)
+ * - `free`: The index of the first event that has been used and released (or
+ *   `NONE`); the rest follow, through `next`
+ * - `overflows`: The number of events that couldn't be scheduled, because
+ *   every event was in use (stops at `UINT16_MAX`)
+ *
+ * Notes:
+ * - Nothing here needs initializing (besides being zeroed), so events may be
+ *   scheduled before `timer__init()` is called.  Events that have never been
+ *   used have a `generation` of `0`, which no handle has.
+ */
+static struct {
+    event_t  event[1+OPT__TIMER__EVENTS];
+    uint8_t  unused;
+    uint8_t  free;
+    uint16_t overflows;
+} pool;
+
+static timer_t timers[TIMERS];
+
 // ----------------------------------------------------------------------------
 // variable manipulator functions ---------------------------------------------
 
-/**                                                functions/resize/description
- * Resize `list->data`, so that the number of unused elements is between
- * `MIN_UNUSED` and `MAX_UNUSED`, inclusive
+/**                                              functions/allocate/description
+ * Take an event from the pool
+ *
+ * Returns:
+ * - success: The index of the event
+ * - failure: `NONE`
+ */
+static uint8_t allocate(void) {
+    uint8_t index = pool.free;
+
+    if (index) {
+        pool.free = pool.event[index].next;
+    } else if (pool.unused < OPT__TIMER__EVENTS) {
+        index = ++pool.unused;
+    } else {
+        if (pool.overflows < UINT16_MAX)
+            pool.overflows++;
+        return NONE;  // error: every event is in use
+    }
+
+    if (!++pool.event[index].generation)
+        pool.event[index].generation = 1;
+
+    return index;
+}
+
+/**                                               functions/release/description
+ * Give an event back to the pool
  *
  * Arguments:
- * - `list`: A pointer to the list to operate on
+ * - `index`: The index of the event
+ */
+static void release(uint8_t index) {
+    pool.event[index].list = FREE;
+    pool.event[index].next = pool.free;
+    pool.free = index;
+}
+
+/**                                                  functions/find/description
+ * Return the index of the event a handle refers to, if it's still waiting to
+ * run
+ *
+ * Arguments:
+ * - `handle`: The handle
  *
  * Returns:
- * - success: `0`
- * - failure: [other]
- *
- * Implementation notes:
- * - We use a signed type for `unused` in case `filled` is greater than
- *   `allocated`, as may happen when appending a new event.  This number should
- *   normally be much smaller than either `filled` or `allocated`, so there is
- *   no need to worry about using a signed type (with a smaller maximum value)
- *   rather than an unsigned one.
- * - The only time `realloc()` should fail is if we are trying to grow the
- *   stack.  See [the documentation]
- *   (http://www.nongnu.org/avr-libc/user-manual/malloc.html)
- *   for `malloc()` in avr-libc.
- */
-static uint8_t resize(list_t * list) {
-    int8_t unused = list->allocated - list->filled;
-
-    if (MIN_UNUSED <= unused && unused <= MAX_UNUSED)
-        return 0;  // nothing to do
-
-    uint8_t new_allocated;
-    if (UINT8_MAX >= list->filled + (MIN_UNUSED+MAX_UNUSED)/2)
-        new_allocated = list->filled + (MIN_UNUSED+MAX_UNUSED)/2;
-    else if (UINT8_MAX >= list->filled + MIN_UNUSED)
-        new_allocated = UINT8_MAX;
-    else
-        return 1;  // unable to count the required number of elements
-
-    void * new_data = realloc( list->data, sizeof(event_t) * new_allocated );
-    if (!new_data)
-        return 1;  // error: `realloc()` failed (unable to grow list)
-
-    list->allocated = new_allocated;
-    list->data = new_data;
+ * - success: The index of the event
+ * - failure: `NONE` (the handle is invalid, or the event has already run, or
+ *   been canceled)
+ */
+static uint8_t find(timer__handle_t handle) {
+    uint8_t index = handle & 0xFF;
+    uint8_t generation = handle >> 8;
 
-    return 0;  // success
+    if ( !index || index > OPT__TIMER__EVENTS
+         || pool.event[index].generation != generation
+         || pool.event[index].list == FREE )
+        return NONE;  // error
+
+    return index;
+}
+
+/**                                                functions/insert/description
+ * Put an event into the right place in `timer`'s list
+ *
+ * Arguments:
+ * - `timer`: A pointer to the timer to operate on
+ * - `index`: The index of the event
+ * - `ticks`: The number of ticks to wait until running the event
+ *
+ * Notes:
+ * - Events due at the same time run in the order they were scheduled.
+ */
+static void insert(timer_t * timer, uint8_t index, uint16_t ticks) {
+    // find the first event that's due later than the new one
+    uint8_t * link = &timer->scheduled;
+    while (*link && pool.event[*link].ticks <= ticks) {
+        ticks -= pool.event[*link].ticks;
+        link = &pool.event[*link].next;
+    }
+
+    // insert the new event before it (which then has less time to wait
+    // after the event before it)
+    if (*link)
+        pool.event[*link].ticks -= ticks;
+    pool.event[index].ticks = ticks;
+    pool.event[index].next  = *link;
+    pool.event[index].list  = timer - timers;
+    *link = index;
+}
+
+/**                                                functions/detach/description
+ * Take an event off whichever list it's on (without releasing it)
+ *
+ * Arguments:
+ * - `index`: The index of the event
+ *
+ * Notes:
+ * - If the event was waiting, the event after it gets its ticks, so nothing
+ *   else runs any sooner or later.
+ */
+static void detach(uint8_t index) {
+    event_t * event = &pool.event[index];
+    timer_t * timer = &timers[event->list & ~DUE];
+
+    uint8_t * link = (event->list & DUE) ? &timer->due : &timer->scheduled;
+    while (*link != index)
+        link = &pool.event[*link].next;
+
+    *link = event->next;
+    if (!(event->list & DUE) && event->next)
+        pool.event[event->next].ticks += event->ticks;
 }
 
-/**                                                functions/append/description
- * Append a new event containing the passed information to `list->data`
+/**                                              functions/schedule/description
+ * Schedule a new event containing the passed information on `timer`
  *
  * Arguments:
- * - `list`: A pointer to the list to operate on
- * - `ticks`: The value to put into the event's corresponding field
- * - `function`: The value to put into the event's corresponding field
+ * - `timer`: A pointer to the timer to operate on
+ * - `ticks`: The number of ticks to wait until running the event
+ * - `function`: The event
+ * - `context`: The argument to pass to `function`
  *
  * Returns:
- * - success: `0`
- * - failure: [other]
+ * - success: A handle to the event
+ * - failure: `0`
  */
-static uint8_t append(list_t * list, uint16_t ticks, void(*function)(void)) {
+static timer__handle_t schedule( timer_t * timer,
+                                 uint16_t  ticks,
+                                 void(*function)(void *),
+                                 void *    context ) {
     if (!function)
-        return 0;  // nothing to do
-
-    if (list->filled == UINT8_MAX)
-        return 1;  // error: list already full
-    list->filled++;
-    if(resize(list)) {
-        list->filled--;
-        return 1;  // resize failed
+        return 0;  // error: nothing to do
+
+    uint8_t index = allocate();
+    if (!index)
+        return 0;  // error: no more room
+
+    pool.event[index].function = function;
+    pool.event[index].context  = context;
+    insert(timer, index, ticks);
+
+    return (timer__handle_t)pool.event[index].generation << 8 | index;
+}
+
+/**                                                functions/expire/description
+ * Let the given number of ticks pass for `timer`'s events, and move the ones
+ * that are due (that have no more ticks to wait) to the end of its `due` list
+ *
+ * Arguments:
+ * - `timer`: A pointer to the timer to operate on
+ * - `ticks`: The number of ticks to let pass
+ */
+static void expire(timer_t * timer, uint16_t ticks) {
+    uint8_t   list = (timer - timers) | DUE;
+    uint8_t * link = &timer->scheduled;
+    while (*link && pool.event[*link].ticks <= ticks) {
+        ticks -= pool.event[*link].ticks;
+        pool.event[*link].list = list;
+        link = &pool.event[*link].next;
     }
 
-    list->data[list->filled - 1].ticks    = ticks;
-    list->data[list->filled - 1].function = function;
+    // (if a tick is already in progress (i.e. this one was started by one of
+    // our events), its events that haven't run yet go first)
+    if (link != &timer->scheduled) {
+        uint8_t * tail = &timer->due;
+        while (*tail)
+            tail = &pool.event[*tail].next;
 
-    return 0;  // success
+        *tail = timer->scheduled;
+        timer->scheduled = *link;
+        *link = NONE;
+    }
+
+    // the next event has that much less time to wait
+    if (timer->scheduled)
+        pool.event[timer->scheduled].ticks -= ticks;
+}
+
+/**                                                   functions/run/description
+ * Run the events on `timer`'s `due` list, in order, releasing each before it
+ * runs (so it can schedule itself again)
+ *
+ * Arguments:
+ * - `timer`: A pointer to the timer to operate on
+ *
+ * Notes:
+ * - An event may cancel or reschedule events that haven't run yet, including
+ *   ones on the `due` list.
+ */
+static void run(timer_t * timer) {
+    while (timer->due) {
+        uint8_t index = timer->due;
+        void (*function)(void *) = pool.event[index].function;
+        void * context = pool.event[index].context;
+
+        timer->due = pool.event[index].next;
+        release(index);
+        (*function)(context);
+    }
 }
 
-/**                                                    function/pop/description
- * Remove the event at `index` from `list->data`
+/**                                                  functions/tick/description
+ * Tick the given timer: increment its counter, and run every event that's
+ * due
  *
  * Arguments:
- * - `list`: A pointer to the list to operate on
- * - `index`: The index of the event to pop
+ * - `timer`: A pointer to the timer to operate on
+ *
+ * Notes:
+ * - The events that are due are taken off the list before any of them run,
+ *   so events scheduled by an event (even for `0` ticks from now) wait until
+ *   the next tick.
  */
-static void pop(list_t * list, uint8_t index) {
-    // shift down
-    // - start with the element at `index`, and copy the element above it down
-    // - continue until we copy the top element (which will then be duplicated
-    //   at indices `list->filled - 2` and `list->filled - 1`)
-    // - if the top element is at `index` (or `index` is out of bounds), this
-    //   will do nothing
-    for (uint8_t i = index; i < list->filled - 1; i++)
-        list->data[i] = list->data[i+1];
+static void tick(timer_t * timer) {
+    timer->counter++;
+
+    expire(timer, 0);
+    if (timer->scheduled)
+        pool.event[timer->scheduled].ticks--;
 
-    // remove an element
-    list->filled--;
-    resize(list);  // we're shrinking the list, so this should never fail
+    run(timer);
 }
 
-// ----------------------------------------------------------------------------
-// variables ------------------------------------------------------------------
+/**                                                  functions/wait/description
+ * Return the number of ticks an event scheduled now on `timer` should wait,
+ * to run `ticks` ticks from now
+ *
+ * Notes:
+ * - The `MILLISECONDS` timer's events wait relative to its `counter` (when
+ *   they were last run), and some time may have passed since.  The wait is
+ *   cut short if it doesn't fit.
+ */
+static uint16_t wait(timer_t * timer, uint16_t ticks) {
+    if (timer != &timers[MILLISECONDS])
+        return ticks;
 
-static timer_t cycles;
-static timer_t keypresses;
+    uint32_t total = (uint16_t)( timer__get_milliseconds() - timer->counter )
+                     + (uint32_t)ticks;
+
+    return total < UINT16_MAX ? total : UINT16_MAX;
+}
 
 // ----------------------------------------------------------------------------
 // front end functions --------------------------------------------------------
 
 uint16_t timer__get_cycles(void) {
-    return cycles.counter;
+    return timers[CYCLES].counter;
 }
 
 uint16_t timer__get_keypresses(void) {
-    return keypresses.counter;
+    return timers[KEYPRESSES].counter;
 }
 
-uint8_t timer__schedule_cycles(uint16_t ticks, void(*function)(void)) {
-    return append(&cycles.scheduled, ticks, function);
+uint16_t timer__get_overflows(void) {
+    return pool.overflows;
 }
 
-uint8_t timer__schedule_keypresses(uint16_t ticks, void(*function)(void)) {
-    return append(&keypresses.scheduled, ticks, function);
+timer__handle_t timer__schedule_cycles( uint16_t ticks,
+                                        void(*function)(void *),
+                                        void *   context ) {
+    return schedule(&timers[CYCLES], ticks, function, context);
+}
+
+timer__handle_t timer__schedule_keypresses( uint16_t ticks,
+                                            void(*function)(void *),
+                                            void *   context ) {
+    return schedule(&timers[KEYPRESSES], ticks, function, context);
+}
+
+timer__handle_t timer__schedule_milliseconds( uint16_t ticks,
+                                              void(*function)(void *),
+                                              void *   context ) {
+    timer_t * timer = &timers[MILLISECONDS];
+    return schedule(timer, wait(timer, ticks), function, context);
+}
+
+uint8_t timer__cancel(timer__handle_t handle) {
+    uint8_t index = find(handle);
+    if (!index)
+        return 1;  // error: not waiting
+
+    detach(index);
+    release(index);
+
+    return 0;  // success
+}
+
+uint8_t timer__reschedule(timer__handle_t handle, uint16_t ticks) {
+    uint8_t index = find(handle);
+    if (!index)
+        return 1;  // error: not waiting
+
+    timer_t * timer = &timers[pool.event[index].list & ~DUE];
+    detach(index);
+    insert(timer, index, wait(timer, ticks));
+
+    return 0;  // success
 }
 
 void timer___tick_cycles(void) {
-    cycles.counter++;
-    for (uint8_t i = 0; i < cycles.scheduled.filled; i++) {
-        if (cycles.scheduled.data[i].ticks == 0) {
-            (*cycles.scheduled.data[i].function)();
-            pop(&cycles.scheduled, i);
-        } else {
-            cycles.scheduled.data[i].ticks--;
-        }
-    }
+    tick(&timers[CYCLES]);
 }
 
 void timer___tick_keypresses(void) {
-    keypresses.counter++;
-    for (uint8_t i = 0; i < keypresses.scheduled.filled; i++) {
-        if (keypresses.scheduled.data[i].ticks == 0) {
-            (*keypresses.scheduled.data[i].function)();
-            pop(&keypresses.scheduled, i);
-        } else {
-            keypresses.scheduled.data[i].ticks--;
-        }
-    }
+    tick(&timers[KEYPRESSES]);
 }
 
+void timer___tick_milliseconds(void) {
+    timer_t * timer = &timers[MILLISECONDS];
+
+    uint16_t now = timer__get_milliseconds();
+    uint16_t passed = now - timer->counter;
+    timer->counter = now;
+
+    expire(timer, passed);
+    run(timer);
+}
@@ -11,6 +11,22 @@
  *
  * Functions are named after the basic TWI actions; see general documentation
  * on TWI for more information.
+ *
+ * Whole transactions may also be queued (`twi__submit()`), to be run by the
+ * TWI interrupt while the CPU does other things.  The basic actions are a
+ * blocking wrapper around the queue: the actions between a START and a STOP
+ * are collected into transactions, which are submitted and waited for
+ * whenever an answer from the bus is needed (see the notes for each).  So
+ * the bus is only ever driven by the queue.
+ *
+ * Notes:
+ * - Since the bus is released between the transactions a block is split
+ *   into, a slave sees each address sent, and each byte read, as a
+ *   transaction of its own.  That's fine for writing registers (which is all
+ *   the firmware uses the basic actions for), and for reading a register (a
+ *   write of its address, a repeated START, and a read); but a slave whose
+ *   register pointer doesn't move on by itself can't be read more than one
+ *   byte at a time this way.  Use a queued transaction for that.
  */
 
 
@@ -20,6 +36,7 @@
 // ----------------------------------------------------------------------------
 
 
+#include <stdbool.h>
 #include <stdint.h>
 
 // ----------------------------------------------------------------------------
@@ -30,11 +47,37 @@
 
 // ----------------------------------------------------------------------------
 
+#define  TWI__QUEUE_LENGTH  8
+#define  TWI__WRITE_LENGTH  8
+#define  TWI__PENDING       0xFF
+#define  TWI__TIMEOUT       0x01
+#define  TWI__TIMEOUT_US    1000
+
+// ----------------------------------------------------------------------------
+
+struct twi__transaction {
+    uint8_t          address;
+    uint8_t const *  write;
+    uint8_t          write_length;
+    uint8_t *        read;
+    uint8_t          read_length;
+    void          (* done) (struct twi__transaction * transaction);
+    volatile uint8_t status;
+};
+
+// ----------------------------------------------------------------------------
+
 void    twi__init  (void);
 uint8_t twi__start (void);
 void    twi__stop  (void);
 uint8_t twi__send  (uint8_t data);
 uint8_t twi__read  (uint8_t * data);
+uint8_t twi__read_last (uint8_t * data);
+
+void    twi__set_wait_hook (void (*hook)(void));
+
+bool    twi__submit (struct twi__transaction * transaction);
+uint8_t twi__wait   (struct twi__transaction * transaction);
 
 
 // ----------------------------------------------------------------------------
@@ -55,6 +98,78 @@ uint8_t twi__read  (uint8_t * data);
 // === OPT__TWI__FREQUENCY ===
 /**                                      macros/OPT__TWI__FREQUENCY/description
  * The TWI Frequency, in Hz.
+ *
+ * Notes:
+ * - Implementations may run the bus slower than this (e.g. if it gives too
+ *   many errors), but never faster.
+ */
+
+// === TWI__QUEUE_LENGTH ===
+/**                                        macros/TWI__QUEUE_LENGTH/description
+ * The number of transactions that may be queued (see `twi__submit()`) at once
+ */
+
+// === TWI__WRITE_LENGTH ===
+/**                                        macros/TWI__WRITE_LENGTH/description
+ * The number of data bytes that may be sent (see `twi__send()`) after each
+ * address, before the next read or STOP
+ */
+
+// === TWI__PENDING ===
+/**                                             macros/TWI__PENDING/description
+ * The status of a transaction that has been queued, but not yet finished
+ */
+
+// === TWI__TIMEOUT ===
+/**                                             macros/TWI__TIMEOUT/description
+ * The status code returned when the bus stops making progress
+ *
+ * Notes:
+ * - Not one of the codes in `<util/twi.h>` (which are all multiples of 8).
+ * - Any wait for the bus gives up after `TWI__TIMEOUT_US` microseconds
+ *   without progress.  The bus is then recovered (any slave holding SDA low
+ *   is clocked until it lets go, a STOP is sent, and the TWI hardware is
+ *   reset), every queued transaction fails with this code, and so does every
+ *   basic action until the next `twi__stop()`.
+ *   So a hung bus costs about `TWI__TIMEOUT_US` (plus the recovery, about
+ *   100 &micro;s) per transaction.  Before `timer__init()` the time can't be
+ *   measured, and the wait may take up to about twice as long.
+ */
+
+// === TWI__TIMEOUT_US ===
+/**                                          macros/TWI__TIMEOUT_US/description
+ * How long to wait for the bus to make progress (finish an action, or a step
+ * of a queued transaction) before giving up, in microseconds
+ */
+
+
+// ----------------------------------------------------------------------------
+// types ----------------------------------------------------------------------
+// ----------------------------------------------------------------------------
+
+// === twi__transaction ===
+/**                                   types/struct twi__transaction/description
+ * A TWI transaction: an optional write, followed by an optional read (after
+ * a repeated START), addressed to a single slave
+ *
+ * Struct members:
+ * - `address`: The 7-bit address of the slave (without the read/write bit)
+ * - `write`: The bytes to send (e.g. a register address, and some data)
+ * - `write_length`: The number of bytes to send
+ * - `read`: Where to put the bytes read
+ * - `read_length`: The number of bytes to read (the last of which will be
+ *   NACKed)
+ * - `done`: A function to call when the transaction has finished, or `NULL`
+ * - `status`: `TWI__PENDING` until the transaction has finished; then `0` for
+ *   success, or the TWI status code of the failure (or `TWI__TIMEOUT`)
+ *
+ * Notes:
+ * - If both `write_length` and `read_length` are `0`, only the address is
+ *   sent (with the write bit), which checks whether the slave is there.
+ * - The transaction (and its buffers) belong to the driver from when it's
+ *   submitted until `status` changes, and must stay where they are until
+ *   then.  Everything but `status` may be set up once, and the transaction
+ *   submitted again and again.
  */
 
 
@@ -76,12 +191,22 @@ uint8_t twi__read  (uint8_t * data);
  *
  * Returns:
  * - success: `0`
- * - failure: The TWI status code
+ * - failure: The TWI status code (of an earlier action, if this is a
+ *   repeated START)
+ *
+ * Notes:
+ * - The START is sent with the next transaction run (see `twi__send()`).
  */
 
 // === twi__stop() ===
 /**                                             functions/twi__stop/description
  * Send a TWI Stop signal
+ *
+ * Notes:
+ * - First writes any data bytes collected (see `twi__send()`), unless
+ *   something has failed.  Whether that works isn't returned, but it's
+ *   counted with the others (e.g. in choosing the bus frequency).
+ * - Clears any failure, so that the next block starts afresh.
  */
 
 // === twi__send() ===
@@ -94,7 +219,15 @@ uint8_t twi__read  (uint8_t * data);
  *
  * Returns:
  * - success: `0`
- * - failure: The TWI status code
+ * - failure: The TWI status code (of this action, or an earlier one); or
+ *   `TW_NO_INFO` if more than `TWI__WRITE_LENGTH` data bytes are sent
+ *
+ * Notes:
+ * - An address (the first byte after a START) is sent right away, alone, so
+ *   we can say whether it was ACKed.  The exception is an address to read
+ *   from the slave we've just written to, which goes with the next read.
+ * - Data bytes are collected, and sent with the next address, read, or
+ *   STOP.  So `0` means only that nothing has failed yet.
  */
 
 // === twi__read() ===
@@ -106,6 +239,100 @@ uint8_t twi__read  (uint8_t * data);
  *
  * Returns:
  * - success: `0`
+ * - failure: The TWI status code (of this action, or an earlier one)
+ *
+ * Notes:
+ * - Runs a transaction that writes any data bytes collected (see
+ *   `twi__send()`), and then reads one byte (which is NACKed, and followed by
+ *   a STOP).
+ */
+
+// === twi__read_last() ===
+/**                                        functions/twi__read_last/description
+ * Read incoming data, and tell the slave not to send any more (by answering
+ * with a NACK instead of an ACK)
+ *
+ * Arguments:
+ * - `data`: A pointer to the location to read data to
+ *
+ * Returns:
+ * - success: `0`
  * - failure: The TWI status code
+ *
+ * Notes:
+ * - Should be used for the last byte of every read, before a STOP or a
+ *   repeated START.  After an ACK, the slave starts sending the next byte,
+ *   and may be holding SDA low when we want to release the bus.
+ * - Since every byte read with `twi__read()` is NACKed already, the two are
+ *   the same.
+ */
+
+// === twi__set_wait_hook() ===
+/**                                    functions/twi__set_wait_hook/description
+ * Set a function to be run each time we have to wait for the bus (including
+ * in `twi__wait()`)
+ *
+ * Arguments:
+ * - `hook`: The function to run, or `NULL` (the default) for none
+ *
+ * Notes:
+ * - The hook is run once per step of the bus (START, or byte sent or read),
+ *   right after the step has been started.  The TWI hardware works on its own, so
+ *   whatever the hook does overlaps with the bus transfer, rather than adding
+ *   to it.  Only the part of the transfer left when the hook returns is spent
+ *   waiting.
+ * - The hook should take about as long as one byte on the bus (22.5 &micro;s,
+ *   at 400kHz) or less.  A longer hook wastes bus time, but does no harm: the
+ *   bus is held until we're ready.
+ * - The hook must not use the TWI functions itself.
+ */
+
+// === twi__submit() ===
+/**                                           functions/twi__submit/description
+ * Queue a transaction, to be run in the background
+ *
+ * Arguments:
+ * - `transaction`: The transaction (see `struct twi__transaction`)
+ *
+ * Returns:
+ * - success: `true`
+ * - failure: `false` (if the queue is full)
+ *
+ * Notes:
+ * - Transactions run in the order they were submitted.  If another one is
+ *   waiting when one finishes successfully, the bus is kept (with a repeated
+ *   START) rather than released.
+ * - `done` is called from the TWI interrupt, so it should be short.  It may
+ *   submit another transaction (including the same one again), which will
+ *   follow without the bus being released.  `status` is already set when
+ *   it's called, but anyone waiting for the transaction won't see that
+ *   until `done` returns.  It isn't called for transactions failed by a bus
+ *   recovery (see `TWI__TIMEOUT`).
+ * - Must not be called between `twi__start()` and `twi__stop()`; and
+ *   `twi__start()` must not be called with the queue full (since the basic
+ *   actions use it too).
+ * - If the queue isn't running, this first waits (with interrupts enabled)
+ *   for the last STOP to finish, which on a hung bus means a timeout (see
+ *   `TWI__TIMEOUT`).  From `done`, the queue is still running, so it never
+ *   waits.
+ */
+
+// === twi__wait() ===
+/**                                             functions/twi__wait/description
+ * Wait for a submitted transaction to finish
+ *
+ * Arguments:
+ * - `transaction`: The transaction to wait for
+ *
+ * Returns:
+ * - success: `0`
+ * - failure: The TWI status code
+ *
+ * Notes:
+ * - The wait hook (see `twi__set_wait_hook()`) is run repeatedly in the
+ *   meantime.
+ * - Transactions submitted before this one will have finished as well.
+ * - Returns (with `TWI__TIMEOUT`) after about `TWI__TIMEOUT_US` without
+ *   progress, even if the bus hangs (see `TWI__TIMEOUT`).
  */
 
@@ -7,8 +7,14 @@
 /**                                                                 description
  * Very simple implementation for the Teensy 2.0 (ATmega32U4)
  *
- * - This is mostly straight from the datasheet, section 20.6.6, figure 20-11
- *   (the code example in C), and section 20.8.1, figure 20-12
+ * - Only the transaction queue is implemented here: the basic actions are a
+ *   wrapper around it (see "blocking.c"), so `TWI_vect` is the only thing
+ *   that drives the bus.
+ * - Queued transactions are run by `TWI_vect`, following the status codes in
+ *   the datasheet, sections 20.8.1 and 20.8.2 (tables 20-3 and 20-4), and
+ *   section 20.6.6, figure 20-11 (the code example in C)
+ * - Bus recovery (after a timeout) follows the NXP I&sup2;C-bus specification
+ *   (UM10204), section 3.1.16 "Bus clear"
  * - Also see the documentation for `<util/twi.h>` at
  *   <http://www.nongnu.org/avr-libc/user-manual/group__util__twi.html#ga8d3aca0acc182f459a51797321728168>
  *
@@ -23,75 +29,476 @@
  */
 
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <util/delay.h>
 #include <util/twi.h>
+#include "../timer.h"
 #include "../twi.h"
 
 // ----------------------------------------------------------------------------
 
-#if OPT__TWI__FREQUENCY > 400000
-    #error "OPT__TWI__FREQUENCY must be <= 400000"
+#if OPT__TWI__FREQUENCY > F_CPU / 16
+    #error "OPT__TWI__FREQUENCY must be <= F_CPU / 16"
 #endif
 /**                                      macros/OPT__TWI__FREQUENCY/description
  * Implementation notes:
- * - The max speed for the ATmega32U4 is 400kHz (datasheet sec. 20.1)
+ * - The max speed for the ATmega32U4 is 400kHz (datasheet sec. 20.1), and
+ *   `TWBR` should be 10 or higher (datasheet section 20.5.2), which at 16MHz
+ *   means about 444kHz or less.  In practice, it can go a good deal faster
+ *   (up to `F_CPU / 16`, with `TWBR = 0`), if the bus is short enough; but
+ *   that's for keyboards to opt into: defaults should stay within the
+ *   datasheet's limits.
  * - The max speed for the MCP23017 is 1.7MHz (datasheet pg. 1)
  * - The max speed for the MCP23018 is 3.4MHz (datasheet pg. 1)
+ * - This is the frequency we start at.  If the bus gives too many errors, we
+ *   step down (see `RATE_EIGHTHS`, `RATE_WINDOW`, and `RATE_MAX_ERRORS`), and
+ *   after a while without any, try stepping back up (see `RATE_RETRY`).
  */
 
 // ----------------------------------------------------------------------------
 
-void twi__init(void) {
+// TWCR values used by the interrupt (see the datasheet, section 20.9.2)
+// - with `TWINT` set (which clears it), to start the next action
+#define  TWCR_NEXT   ( (1<<TWINT)|(1<<TWEN)|(1<<TWIE) )
+#define  TWCR_ACK    ( TWCR_NEXT|(1<<TWEA) )
+#define  TWCR_START  ( TWCR_NEXT|(1<<TWSTA) )
+#define  TWCR_STOP   ( (1<<TWINT)|(1<<TWEN)|(1<<TWSTO) )
+
+// the TWI pins (on port D), for bus recovery
+#define  SCL  0
+#define  SDA  1
+
+/**                                             macros/RATE_EIGHTHS/description
+ * The bus frequencies we may run at, in eighths of `OPT__TWI__FREQUENCY`,
+ * fastest first
+ *
+ * Notes:
+ * - Never slower than `RATE_MIN` though.
+ */
+#define  RATE_EIGHTHS  { 8, 6, 4, 3, 2, 1 }
+
+/**                                                 macros/RATE_MIN/description
+ * The slowest bus frequency we'll step down to, in Hz
+ */
+#define  RATE_MIN  100000
+
+/**                                              macros/RATE_WINDOW/description
+ * The number of transactions to count errors over
+ */
+#define  RATE_WINDOW  64
+
+/**                                          macros/RATE_MAX_ERRORS/description
+ * The number of failed transactions (of `RATE_WINDOW`) above which we step
+ * down to the next slower frequency
+ *
+ * Notes:
+ * - Every failure counts, including an address NACK (which is how a garbled
+ *   address looks, but also how a missing slave looks).  So with the left
+ *   half unplugged, we'll step down to the slowest frequency; and once it's
+ *   plugged back in, step back up.
+ */
+#define  RATE_MAX_ERRORS  2
+
+/**                                               macros/RATE_RETRY/description
+ * The number of windows in a row without any errors, after which we try the
+ * next faster frequency
+ *
+ * Notes:
+ * - If the faster frequency gives errors, we step back down after one
+ *   window.  So an unreliable frequency costs at most `RATE_MAX_ERRORS + 1`
+ *   failed transactions every `RATE_RETRY` windows (about every 4 seconds,
+ *   for the ErgoDox, scanning every millisecond).
+ */
+#define  RATE_RETRY  64
+
+/**                                                  macros/POLL_US/description
+ * How often to check whether the hardware is done, while waiting, in
+ * microseconds
+ */
+#define  POLL_US  0.5
+
+/**                                              macros/CLOCK_POLLS/description
+ * The number of checks to make between readings of the clock, while waiting
+ * (since reading it takes a few microseconds itself)
+ */
+#define  CLOCK_POLLS  16
+
+/**                                            macros/TIMEOUT_POLLS/description
+ * The number of checks to make before giving up, if the clock isn't running
+ * yet (see `timed_out()`)
+ */
+#define  TIMEOUT_POLLS  ( (uint16_t)(TWI__TIMEOUT_US / POLL_US) )
+
+/**                                              macros/RECOVERY_US/description
+ * Half of an SCL period, while recovering the bus, in microseconds (for a
+ * 100kHz clock, which every slave supports)
+ */
+#define  RECOVERY_US  5
+
+// ----------------------------------------------------------------------------
+
+/**                                             variables/wait_hook/description
+ * The function to run while the hardware is busy (see `twi__set_wait_hook()`)
+ */
+static void (*wait_hook)(void);
+
+/**                                                 variables/queue/description
+ * The transactions waiting to run (the first of which is running)
+ *
+ * Struct members:
+ * - `transaction`: A ring buffer of pointers to the transactions
+ * - `head`: The index of the first transaction
+ * - `length`: The number of transactions in the queue
+ * - `index`: The index of the next byte to send or read, in the running
+ *   transaction
+ * - `reading`: Whether the running transaction has moved on to reading
+ * - `running`: Whether the interrupt is running the queue (and has the bus)
+ * - `progress`: Incremented each time the interrupt runs (so we can tell if
+ *   the bus has hung)
+ */
+static volatile struct {
+	struct twi__transaction * transaction[TWI__QUEUE_LENGTH];
+	uint8_t head;
+	uint8_t length;
+	uint8_t index;
+	bool    reading;
+	bool    running;
+	uint8_t progress;
+} queue;
+
+/**                                                  variables/rate/description
+ * The state of the bus frequency selection
+ *
+ * Struct members:
+ * - `level`: The index of the current frequency, in `RATE_EIGHTHS`
+ * - `transactions`: The number of transactions so far, in this window
+ * - `errors`: The number of those that failed
+ * - `clean`: The number of windows in a row without errors
+ */
+static struct {
+	uint8_t level;
+	uint8_t transactions;
+	uint8_t errors;
+	uint8_t clean;
+} rate;
+
+// ----------------------------------------------------------------------------
+
+/**                                              functions/set_rate/description
+ * Set the bus frequency, according to `rate.level`
+ */
+static void set_rate(void) {
+	static uint8_t const eighths[] = RATE_EIGHTHS;
+	uint32_t frequency = (uint32_t)OPT__TWI__FREQUENCY
+	                   * eighths[rate.level] / 8;
+
+	if (frequency < RATE_MIN)
+		frequency = RATE_MIN;
+
 	// set the prescaler value to 0
 	TWSR &= ~( (1<<TWPS1)|(1<<TWPS0) );
 	// set the bit rate
-	// - TWBR should be 10 or higher (datasheet section 20.5.2)
-	TWBR = ((F_CPU / OPT__TWI__FREQUENCY) - 16) / 2;
+	TWBR = ((F_CPU / frequency) - 16) / 2;
 }
 
-uint8_t twi__start(void) {
-	// send start
-	TWCR = (1<<TWINT)|(1<<TWEN)|(1<<TWSTA);
-	// wait for transmission to complete
-	while (!(TWCR & (1<<TWINT)));
-	// if it didn't work, return the status code (else return 0)
-	if ( (TW_STATUS != TW_START) &&
-	     (TW_STATUS != TW_REP_START) )
-		return TW_STATUS;  // error
-	return 0;  // success
+/**                                               functions/account/description
+ * Note how a transaction went, and change the bus frequency if it's time
+ *
+ * Arguments:
+ * - `error`: Whether the transaction failed
+ */
+static void account(bool error) {
+	static uint8_t const levels = sizeof((uint8_t[])RATE_EIGHTHS);
+
+	rate.transactions++;
+	if (error)
+		rate.errors++;
+
+	if (rate.transactions < RATE_WINDOW)
+		return;
+
+	if (rate.errors > RATE_MAX_ERRORS && rate.level < levels-1) {
+		rate.level++;  // slower
+		set_rate();
+	} else if (rate.errors) {
+		rate.clean = 0;
+	} else if (++rate.clean >= RATE_RETRY && rate.level > 0) {
+		rate.level--;  // faster
+		rate.clean = 0;
+		set_rate();
+	}
+
+	rate.transactions = 0;
+	rate.errors = 0;
+}
+
+/**                                               functions/recover/description
+ * Get the bus working again, after it's stopped making progress
+ *
+ * - Disable the TWI hardware, and fail every queued transaction (with
+ *   `TWI__TIMEOUT`).
+ * - Clock SCL (by hand) until any slave in the middle of sending something
+ *   lets go of SDA (9 clocks at most), then send a STOP.
+ * - Re-initialize the TWI hardware.
+ *
+ * Notes:
+ * - The bus is pulled up externally.  A pin is pulled low by making it an
+ *   output (with `PORTD` low), and released by making it an input again.
+ */
+static void recover(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		TWCR = 0;  // disable the TWI hardware (and interrupt)
+
+		while (queue.length) {
+			queue.transaction[queue.head]->status = TWI__TIMEOUT;
+			queue.head = (queue.head + 1) % TWI__QUEUE_LENGTH;
+			queue.length--;
+		}
+		queue.reading = false;
+		queue.running = false;
+	}
+	account(true);
+
+	uint8_t port = PORTD & ( (1<<SCL)|(1<<SDA) );
+	PORTD &= ~( (1<<SCL)|(1<<SDA) );
+
+	// clock out whatever's holding SDA low
+	DDRD &= ~(1<<SDA);
+	for (uint8_t i = 0; i < 9 && !(PIND & (1<<SDA)); i++) {
+		DDRD |=  (1<<SCL); _delay_us(RECOVERY_US);
+		DDRD &= ~(1<<SCL); _delay_us(RECOVERY_US);
+	}
+
+	// STOP: SDA goes high while SCL is high
+	DDRD |=  (1<<SCL); _delay_us(RECOVERY_US);
+	DDRD |=  (1<<SDA); _delay_us(RECOVERY_US);
+	DDRD &= ~(1<<SCL); _delay_us(RECOVERY_US);
+	DDRD &= ~(1<<SDA); _delay_us(RECOVERY_US);
+
+	PORTD |= port;
+
+	set_rate();
+	TWCR = (1<<TWEN);
 }
 
-void twi__stop(void) {
-	// send stop
-	TWCR = (1<<TWINT)|(1<<TWEN)|(1<<TWSTO);
-	// wait for transmission to complete
-	while (TWCR & (1<<TWSTO));
+/**                                             functions/timed_out/description
+ * Wait `POLL_US`, and say whether we've been waiting for `TWI__TIMEOUT_US`
+ *
+ * Arguments:
+ * - `start`: The time we started waiting (from `timer__get_microseconds()`)
+ * - `polls`: The number of times we've been called, for this wait (to be
+ *   incremented)
+ *
+ * Notes:
+ * - Each poll takes quite a bit longer than `POLL_US` (about twice as long,
+ *   counting the loop around it), so the time is measured with the clock,
+ *   every `CLOCK_POLLS` polls.  That's accurate to within a few tens of
+ *   microseconds.
+ * - Before `timer__init()` (e.g. during `kb__init()`) the clock doesn't run,
+ *   so we also give up after `TIMEOUT_POLLS` polls.  That takes at least
+ *   `TWI__TIMEOUT_US`, and (at 16MHz) up to about twice that.
+ */
+static bool timed_out(uint16_t start, uint16_t * polls) {
+	_delay_us(POLL_US);
+	(*polls)++;
+
+	if ( !(*polls % CLOCK_POLLS) &&
+	     (uint16_t)(timer__get_microseconds() - start) >= TWI__TIMEOUT_US )
+		return true;
+
+	return *polls >= TIMEOUT_POLLS;
 }
 
-uint8_t twi__send(uint8_t data) {
-	// load data into the data register
-	TWDR = data;
-	// send data
-	TWCR = (1<<TWINT)|(1<<TWEN);
-	// wait for transmission to complete
-	while (!(TWCR & (1<<TWINT)));
-	// if it didn't work, return the status code (else return 0)
-	if ( (TW_STATUS != TW_MT_SLA_ACK)  &&
-	     (TW_STATUS != TW_MT_DATA_ACK) &&
-	     (TW_STATUS != TW_MR_SLA_ACK) )
-		return TW_STATUS;  // error
+/**                                            functions/wait_while/description
+ * Wait while `(TWCR & mask) == value` (for at most `TWI__TIMEOUT_US`), and
+ * recover the bus if it's still true then
+ *
+ * Returns:
+ * - success: `0`
+ * - failure: `TWI__TIMEOUT`
+ */
+static uint8_t wait_while(uint8_t mask, uint8_t value) {
+	uint16_t start = timer__get_microseconds();
+	uint16_t polls = 0;
+
+	while ( (TWCR & mask) == value ) {
+		if (timed_out(start, &polls)) {
+			recover();
+			return TWI__TIMEOUT;  // error
+		}
+	}
 	return 0;  // success
 }
 
-uint8_t twi__read(uint8_t * data) {
-	// read 1 byte to TWDR, send ACK
-	TWCR = (1<<TWINT)|(1<<TWEN)|(1<<TWEA);
-	// wait for transmission to complete
-	while (!(TWCR & (1<<TWINT)));
-	// set data variable
-	*data = TWDR;
-	// if it didn't work, return the status code (else return 0)
-	if (TW_STATUS != TW_MR_DATA_ACK)
-		return TW_STATUS;  // error
-	return 0;  // success
+/**                                            functions/wait_queue/description
+ * Wait for the given transaction to finish, running the wait hook (if there
+ * is one) each time the interrupt makes progress, and recovering the bus if
+ * it doesn't for `TWI__TIMEOUT_US`
+ */
+static void wait_queue(struct twi__transaction * transaction) {
+	for (;;) {
+		uint8_t progress = queue.progress;
+
+		if (transaction->status != TWI__PENDING)
+			return;
+
+		if (wait_hook)
+			wait_hook();
+
+		uint16_t start = timer__get_microseconds();
+		uint16_t polls = 0;
+
+		while (queue.progress == progress) {
+			if (timed_out(start, &polls)) {
+				recover();
+				return;
+			}
+		}
+	}
 }
 
+/**                                                functions/finish/description
+ * Finish the running transaction, and start the next one (if there is one)
+ *
+ * Arguments:
+ * - `status`: `0`, or the TWI status code of the failure
+ *
+ * Notes:
+ * - Must be called from `TWI_vect`.
+ * - The transaction's `done` function runs before we decide whether to keep
+ *   the bus, so anything it submits follows with a repeated START.
+ */
+static void finish(uint8_t status) {
+	struct twi__transaction * transaction = queue.transaction[queue.head];
+
+	queue.head = (queue.head + 1) % TWI__QUEUE_LENGTH;
+	queue.length--;
+	queue.reading = false;
+
+	account(status);
+	transaction->status = status;
+	if (transaction->done)
+		transaction->done(transaction);
+
+	if (!queue.length) {
+		TWCR = TWCR_STOP;  // (and stop interrupting)
+		queue.running = false;
+	} else if (!status) {
+		TWCR = TWCR_START;  // repeated START: keep the bus
+	} else {
+		TWCR = TWCR_START|(1<<TWSTO);  // STOP, then START
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+/**                                              functions/TWI_vect/description
+ * Run the next step of the first transaction in the queue
+ */
+ISR(TWI_vect) {
+	struct twi__transaction * transaction = queue.transaction[queue.head];
+
+	queue.progress++;
+
+	switch (TW_STATUS) {
+		case TW_START:
+		case TW_REP_START:
+			if (!transaction->write_length && transaction->read_length)
+				queue.reading = true;
+			queue.index = 0;
+			TWDR = (transaction->address << 1)
+			     | (queue.reading ? TW_READ : TW_WRITE);
+			TWCR = TWCR_NEXT;
+			break;
+
+		case TW_MT_SLA_ACK:
+		case TW_MT_DATA_ACK:
+			if (queue.index < transaction->write_length) {
+				TWDR = transaction->write[queue.index++];
+				TWCR = TWCR_NEXT;
+			} else if (transaction->read_length) {
+				queue.reading = true;
+				TWCR = TWCR_START;  // repeated START, to read
+			} else {
+				finish(0);  // success
+			}
+			break;
+
+		case TW_MR_SLA_ACK:
+			queue.index = 0;
+			TWCR = transaction->read_length > 1 ? TWCR_ACK : TWCR_NEXT;
+			break;
+
+		case TW_MR_DATA_ACK:
+			transaction->read[queue.index++] = TWDR;
+			TWCR = queue.index < transaction->read_length - 1 ? TWCR_ACK
+			                                                 : TWCR_NEXT;
+			break;
+
+		case TW_MR_DATA_NACK:
+			transaction->read[queue.index] = TWDR;
+			finish(0);  // success
+			break;
+
+		default:  // a NACK, lost arbitration, or a bus error
+			// (a bus error's status code is `0`, which would mean success)
+			finish(TW_STATUS ? TW_STATUS : TW_NO_INFO);  // error
+			break;
+	}
+}
+
+// ----------------------------------------------------------------------------
+
+void twi__init(void) {
+	rate.level = 0;  // start fast
+	set_rate();
+}
+
+void twi__set_wait_hook(void (*hook)(void)) {
+	wait_hook = hook;
+}
+
+bool twi__submit(struct twi__transaction * transaction) {
+	for (bool queued = false; !queued;) {
+		// if the queue isn't running, let the last STOP finish first
+		// - with interrupts enabled, since on a hung bus this takes
+		//   `TWI__TIMEOUT_US`, and then the recovery
+		if (!queue.running && wait_while(1<<TWSTO, 1<<TWSTO)) {
+			transaction->status = TWI__TIMEOUT;  // error
+			return true;  // (it's finished)
+		}
+
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			if (queue.length == TWI__QUEUE_LENGTH)
+				return false;  // error: queue full
+
+			// (unless the interrupt has sent another STOP since we
+			// checked, in which case we wait for that one too)
+			if ( queue.running || !(TWCR & (1<<TWSTO)) ) {
+				transaction->status = TWI__PENDING;
+				queue.transaction[ (queue.head + queue.length)
+				                   % TWI__QUEUE_LENGTH ] = transaction;
+
+				queue.length++;
+
+				// if the queue isn't running, start it
+				if (!queue.running) {
+					queue.running = true;
+					TWCR = TWCR_START;
+				}
+
+				queued = true;
+			}
+		}
+	}
+	return true;  // success
+}
+
+uint8_t twi__wait(struct twi__transaction * transaction) {
+	wait_queue(transaction);
+	return transaction->status;
+}
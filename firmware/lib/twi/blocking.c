@@ -0,0 +1,139 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * Implements the device agnostic portion of the TWI interface defined in
+ * "../twi.h": the basic actions, as a wrapper around the transaction queue
+ *
+ * Notes:
+ * - The actions between a START and a STOP are collected into transactions
+ *   (see `struct twi__transaction`), which are submitted, and waited for,
+ *   whenever the caller needs an answer from the bus.  So the queue (the
+ *   interrupt, on the hardware) is the only thing that drives the bus, and
+ *   timeouts, recovery, and error counting are all handled there.
+ * - Each address sent is checked right away, with a transaction that sends
+ *   only the address, so that `twi__send()` can say whether it was ACKed.
+ * - Data bytes sent are collected, and written (as one transaction) by the
+ *   next address, read, or STOP.
+ * - Each byte read is a transaction of its own, which first writes any bytes
+ *   collected (so a register address, a repeated START, and a read of the
+ *   same slave run as one transaction, as usual).
+ */
+
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <util/twi.h>
+#include "../twi.h"
+
+// ----------------------------------------------------------------------------
+
+/**                                                 variables/block/description
+ * The state of the basic actions, between `twi__start()` and `twi__stop()`
+ *
+ * Struct members:
+ * - `transaction`: The transaction being collected (or run)
+ * - `write`: The data bytes collected, for `transaction` to write
+ * - `addressing`: Whether the next byte sent is an address (i.e. a (repeated)
+ *   START was just sent)
+ * - `status`: `0`, or the status of the first failure (after which every
+ *   action fails, until the next STOP)
+ */
+static struct {
+    struct twi__transaction transaction;
+    uint8_t                 write[TWI__WRITE_LENGTH];
+    bool                    addressing;
+    uint8_t                 status;
+} block = {
+    .transaction = { .write = block.write },
+};
+
+// ----------------------------------------------------------------------------
+
+/**                                                   functions/run/description
+ * Run the transaction collected so far (writing the data bytes collected,
+ * if any, and then reading a byte, if asked to), and wait for it
+ *
+ * Arguments:
+ * - `read`: Where to put the byte read, or `NULL` to only write
+ *
+ * Returns:
+ * - success: `0`
+ * - failure: The TWI status code (also kept in `block.status`)
+ *
+ * Notes:
+ * - The queue is only full if someone has submitted transactions without
+ *   waiting for them, which they mustn't do before `twi__start()` (see
+ *   "../twi.h").  If it is, we fail with `TW_NO_INFO`, rather than wait.
+ */
+static uint8_t run(uint8_t * read) {
+    block.transaction.read        = read;
+    block.transaction.read_length = read ? 1 : 0;
+
+    if (!twi__submit(&block.transaction))
+        block.status = TW_NO_INFO;  // error: queue full
+    else
+        block.status = twi__wait(&block.transaction);
+
+    block.transaction.write_length = 0;
+    return block.status;
+}
+
+// ----------------------------------------------------------------------------
+
+uint8_t twi__start(void) {
+    block.addressing = true;
+    return block.status;
+}
+
+void twi__stop(void) {
+    if (!block.status && block.transaction.write_length)
+        run(NULL);
+
+    block.transaction.write_length = 0;
+    block.addressing = false;
+    block.status = 0;
+}
+
+uint8_t twi__send(uint8_t data) {
+    if (block.status)
+        return block.status;  // error: something already failed
+
+    if (block.addressing) {
+        block.addressing = false;
+
+        // a read from the slave we've been writing to: what we've written
+        // (e.g. a register address) goes with the first byte read
+        if ( block.transaction.write_length
+             && (data & 1) == TW_READ
+             && data >> 1 == block.transaction.address )
+            return 0;  // success (so far)
+
+        if (block.transaction.write_length && run(NULL))
+            return block.status;  // error
+
+        block.transaction.address = data >> 1;
+        return run(NULL);  // (only the address: is the slave there?)
+    }
+
+    if (block.transaction.write_length == TWI__WRITE_LENGTH)
+        return block.status = TW_NO_INFO;  // error: too many bytes
+
+    block.write[block.transaction.write_length++] = data;
+    return 0;  // success (so far)
+}
+
+uint8_t twi__read(uint8_t * data) {
+    if (block.status)
+        return block.status;  // error: something already failed
+
+    return run(data);
+}
+
+uint8_t twi__read_last(uint8_t * data) {
+    return twi__read(data);
+}
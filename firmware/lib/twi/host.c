@@ -0,0 +1,335 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * Implements the device specific portion of the TWI interface defined in
+ * "../twi.h" (the transaction queue) for host builds
+ *
+ * Notes:
+ * - The devices on the simulated bus are modeled by the keyboard (see the
+ *   "board" section of "../host.h"): we pass them every address and data
+ *   byte, and every STOP, and let them decide whether to ACK.  Addresses
+ *   nobody claims are NACKed, as they would be with nothing plugged in.
+ * - Each action takes as long as it would on the wire, at
+ *   `OPT__TWI__FREQUENCY` (faults are only injected when a script asks for
+ *   them, so there's no reason to slow down), and is counted (see
+ *   `host__twi__started()`).
+ * - Faults are injected as the script asks (see `host__twi__fault()`).  A
+ *   hung bus is handled as on the hardware: the action waits
+ *   `TWI__TIMEOUT_US`, the bus is recovered, and every queued transaction
+ *   fails with `TWI__TIMEOUT` (see "../twi.h").
+ * - There are no interrupts: queued transactions are run (a byte at a time,
+ *   as the interrupt would) when something waits for them.  The basic
+ *   actions are a wrapper around the queue (see "blocking.c"), as on the
+ *   hardware.
+ */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <util/twi.h>
+#include "../host.h"
+#include "../twi.h"
+
+// ----------------------------------------------------------------------------
+
+/**                                                   macros/BIT_NS/description
+ * The time it takes to send one bit, in nanoseconds
+ */
+#define  BIT_NS  (1000000000UL / OPT__TWI__FREQUENCY)
+
+/**                                                macros/NS_CYCLES/description
+ * The number of CPU cycles in the given number of nanoseconds
+ */
+#define  NS_CYCLES(ns)  ((uint32_t)(ns) * (F_CPU / 1000000) / 1000)
+
+/**                                              macros/RECOVERY_NS/description
+ * The time it takes to recover the bus (9 clocks, and a STOP, at 100 kHz), in
+ * nanoseconds
+ */
+#define  RECOVERY_NS  110000UL
+
+// ----------------------------------------------------------------------------
+
+/**                                             variables/wait_hook/description
+ * The function to run while the bus is busy (see `twi__set_wait_hook()`)
+ */
+static void (*wait_hook)(void);
+
+/**                                                 variables/queue/description
+ * The transactions waiting to run
+ *
+ * Struct members:
+ * - `transaction`: A ring buffer of pointers to the transactions
+ * - `head`: The index of the first transaction
+ * - `length`: The number of transactions in the queue
+ * - `running`: Whether we're running the queue (so a `done` function that
+ *   waits shouldn't start running it again)
+ */
+static struct {
+    struct twi__transaction * transaction[TWI__QUEUE_LENGTH];
+    uint8_t head;
+    uint8_t length;
+    bool    running;
+} queue;
+
+/**                                                   variables/bus/description
+ * The state of the bus
+ *
+ * Struct members:
+ * - `addressing`: Whether the next byte sent is an address (i.e. a (repeated)
+ *   START was just sent)
+ * - `selected`: Whether a device ACKed the last address
+ * - `reading`: Whether the last address was for a read
+ * - `recovered`: Whether the bus has been recovered during the current
+ *   transaction (so the rest of it should fail)
+ */
+static struct {
+    bool addressing;
+    bool selected;
+    bool reading;
+    bool recovered;
+} bus;
+
+// ----------------------------------------------------------------------------
+
+/**                                              functions/transfer/description
+ * Let the bus be busy for the given number of nanoseconds, running the wait
+ * hook (if there is one) in the meantime
+ *
+ * Notes:
+ * - Time the hook takes counts toward the transfer, as it would on the
+ *   hardware, where the TWI module works independently of the CPU.
+ */
+static void transfer(uint32_t nanoseconds) {
+    uint32_t done = host__cycles() + NS_CYCLES(nanoseconds);
+
+    host__twi__busy(nanoseconds);
+
+    if (wait_hook)
+        wait_hook();
+
+    int32_t remaining = done - host__cycles();
+    if (remaining > 0)
+        host__delay_ns( (uint32_t)remaining * 1000 / (F_CPU / 1000000) );
+}
+
+/**                                                  functions/hang/description
+ * Wait for a hung bus to time out, then recover it
+ *
+ * Returns:
+ * - `TWI__TIMEOUT`
+ *
+ * Notes:
+ * - Every queued transaction fails (without its `done` function being
+ *   called), and so does every action until the next START.
+ */
+static uint8_t hang(void) {
+    transfer(TWI__TIMEOUT_US * 1000UL);
+
+    while (queue.length) {
+        queue.transaction[queue.head]->status = TWI__TIMEOUT;
+        queue.head = (queue.head + 1) % TWI__QUEUE_LENGTH;
+        queue.length--;
+    }
+
+    transfer(RECOVERY_NS);
+    if (bus.selected)
+        host__board__twi_stop();  // (the recovery ends with a STOP)
+
+    bus.addressing = false;
+    bus.selected = false;
+    bus.recovered = true;
+
+    return TWI__TIMEOUT;  // error
+}
+
+/**                                                 functions/start/description
+ * Send a (repeated) START
+ *
+ * Returns:
+ * - success: `0`
+ * - failure: `TWI__TIMEOUT`
+ */
+static uint8_t start(void) {
+    if (bus.recovered)
+        return TWI__TIMEOUT;  // error
+    if (host__twi__fault(HOST__TWI__HANG))
+        return hang();
+
+    host__twi__started();
+    transfer(BIT_NS);
+    bus.addressing = true;
+    return 0;  // success
+}
+
+/**                                                  functions/stop/description
+ * Send a STOP (unless the bus has been recovered, which already sent one)
+ */
+static void stop(void) {
+    if (bus.recovered) {
+        bus.recovered = false;
+        return;
+    }
+
+    transfer(BIT_NS);
+    if (bus.selected)
+        host__board__twi_stop();
+
+    bus.addressing = false;
+    bus.selected = false;
+}
+
+/**                                                  functions/send/description
+ * Send an address or data byte
+ *
+ * Returns:
+ * - success: `0`
+ * - failure: The TWI status code
+ */
+static uint8_t send(uint8_t data) {
+    if (bus.recovered)
+        return TWI__TIMEOUT;  // error
+    if (host__twi__fault(HOST__TWI__HANG))
+        return hang();
+
+    host__twi__byte();
+    transfer(9 * BIT_NS);  // (8 data bits, and the (N)ACK)
+
+    if (bus.addressing) {
+        bus.addressing = false;
+        bus.reading = (data & 1) == TW_READ;
+        bus.selected = host__board__twi_address(data)
+                       && !host__twi__fault(HOST__TWI__NACK);
+        if (!bus.selected)
+            return bus.reading ? TW_MR_SLA_NACK : TW_MT_SLA_NACK;  // error
+        return 0;  // success
+    }
+
+    if (!bus.selected || bus.reading || !host__board__twi_write(data))
+        return TW_MT_DATA_NACK;  // error
+    return 0;  // success
+}
+
+/**                                                  functions/read/description
+ * Read a data byte
+ *
+ * Returns:
+ * - success: `0`
+ * - failure: The TWI status code
+ *
+ * Notes:
+ * - With nobody sending, the bus reads as `0xFF` (it's pulled high).
+ * - Whether we ACK or NACK the byte doesn't matter to the simulated devices.
+ */
+static uint8_t read(uint8_t * data) {
+    if (bus.recovered)
+        return TWI__TIMEOUT;  // error
+    if (host__twi__fault(HOST__TWI__HANG))
+        return hang();
+
+    host__twi__byte();
+    transfer(9 * BIT_NS);
+
+    *data = 0xFF;
+    if (bus.selected && bus.reading) {
+        *data = host__board__twi_read();
+        if (host__twi__fault(HOST__TWI__GARBLE))
+            *data ^= 0x01;
+    }
+
+    return 0;  // success (the (N)ACK is ours)
+}
+
+/**                                               functions/run_one/description
+ * Run a transaction, up to (but not including) the STOP
+ *
+ * Returns:
+ * - success: `0`
+ * - failure: The TWI status code
+ */
+static uint8_t run_one(struct twi__transaction * transaction) {
+    uint8_t address = transaction->address << 1;
+    uint8_t ret;
+
+    if (( ret = start() ))
+        return ret;
+
+    if (transaction->write_length || !transaction->read_length) {
+        if (( ret = send(address | TW_WRITE) ))
+            return ret;
+        for (uint8_t i = 0; i < transaction->write_length; i++)
+            if (( ret = send(transaction->write[i]) ))
+                return ret;
+        if (!transaction->read_length)
+            return 0;
+        if (( ret = start() ))
+            return ret;
+    }
+
+    if (( ret = send(address | TW_READ) ))
+        return ret;
+    for (uint8_t i = 0; i < transaction->read_length; i++)
+        if (( ret = read(&transaction->read[i]) ))
+            return ret;
+    return 0;
+}
+
+/**                                                   functions/run/description
+ * Run every transaction in the queue, as the interrupt would have
+ */
+static void run(void) {
+    if (queue.running)
+        return;
+    queue.running = true;
+
+    while (queue.length) {
+        struct twi__transaction * transaction = queue.transaction[queue.head];
+
+        bus.recovered = false;  // (each transaction starts afresh)
+        uint8_t status = run_one(transaction);
+        if (transaction->status != TWI__PENDING)
+            continue;  // failed by a bus recovery, along with the rest
+
+        queue.head = (queue.head + 1) % TWI__QUEUE_LENGTH;
+        queue.length--;
+
+        transaction->status = status;
+        if (transaction->done)
+            transaction->done(transaction);
+
+        if (status || !queue.length)
+            stop();  // (otherwise, the next START is a repeated START)
+    }
+
+    bus.recovered = false;
+    queue.running = false;
+}
+
+// ----------------------------------------------------------------------------
+
+void twi__init(void) {}
+
+void twi__set_wait_hook(void (*hook)(void)) {
+    wait_hook = hook;
+}
+
+bool twi__submit(struct twi__transaction * transaction) {
+    if (queue.length == TWI__QUEUE_LENGTH)
+        return false;  // error: queue full
+
+    transaction->status = TWI__PENDING;
+    queue.transaction[ (queue.head + queue.length) % TWI__QUEUE_LENGTH ]
+        = transaction;
+    queue.length++;
+
+    return true;  // success
+}
+
+uint8_t twi__wait(struct twi__transaction * transaction) {
+    run();
+    return transaction->status;
+}
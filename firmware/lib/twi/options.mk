@@ -11,5 +11,8 @@
 #
 
 
+$(call include_options_once,lib/timer)
+
+SRC += $(CURDIR)/blocking.c
 SRC += $(wildcard $(CURDIR)/$(MCU).c)
 
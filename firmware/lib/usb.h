@@ -29,12 +29,13 @@ bool usb__is_configured (void);
 
 // --- keyboard ---
 
-uint8_t usb__kb__set_key     (bool pressed, uint8_t keycode);
-bool    usb__kb__read_key    (uint8_t keycode);
-bool    usb__kb__read_led    (char led);
-uint8_t usb__kb__send_report (void);
+uint8_t usb__kb__set_key         (bool pressed, uint8_t keycode);
+bool    usb__kb__read_key        (uint8_t keycode);
+bool    usb__kb__read_led        (char led);
+uint8_t usb__kb__send_report     (void);
+uint8_t usb__kb__try_send_report (void);
 
-void    usb__kb__toggle_nkro (void);
+void    usb__kb__toggle_nkro     (void);
 
 // --- mouse ---
 #define MOUSE_BTN1 (1<<0)
@@ -148,10 +149,33 @@ void usb__m__buttons(uint8_t buttons);
 // === usb__kb__send_report() ===
 /**                                  functions/usb__kb__send_report/description
  * Send the USB report to the host (update the host on the state of the
- * keycodes)
+ * keycodes), if it has changed since it was last sent
  *
  * Returns:
  * - success: `0`
  * - failure: status code (unspecified, nonzero)
+ *
+ * Notes:
+ * - Waits (for a limited time) if the host hasn't yet read the last report.
+ *   Functions that need the host to see a sequence of states (e.g. press,
+ *   then release) should use this.
+ * - If the report could not be sent, it will be sent by the next call to this
+ *   function or to `usb__kb__try_send_report()`.
+ * - While nothing changes, the host is still reminded of the current state as
+ *   often as it asked to be (with `SET_IDLE`), without our involvement.
+ */
+
+// === usb__kb__try_send_report() ===
+/**                              functions/usb__kb__try_send_report/description
+ * Like `usb__kb__send_report()`, but fail immediately (instead of waiting) if
+ * the host hasn't yet read the last report
+ *
+ * Returns:
+ * - success: `0`
+ * - failure: status code (unspecified, nonzero)
+ *
+ * Notes:
+ * - Meant for `main()`: a report that could not be sent will be retried on
+ *   the next scan, and the main loop never stalls waiting for the host.
  */
 
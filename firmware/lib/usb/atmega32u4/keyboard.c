@@ -17,11 +17,24 @@
 
 // ----------------------------------------------------------------------------
 
+/**                                                 variables/dirty/description
+ * Whether the report has changed since it was last sent
+ */
+static bool dirty;
+
+// ----------------------------------------------------------------------------
+
 uint8_t usb__kb__set_key(bool pressed, uint8_t keycode) {
     // no-op
     if (keycode == 0)
         return 1;
 
+    // nothing to change
+    if (usb__kb__read_key(keycode) == pressed)
+        return 0;
+
+    dirty = true;
+
     // modifier keys
     switch (keycode) {
         case KEYBOARD__LeftControl:  (pressed)
@@ -134,7 +147,23 @@ bool usb__kb__read_led(char led) {
 }
 
 uint8_t usb__kb__send_report(void) {
-    return usb_keyboard_send();
+    if (!dirty)
+        return 0;
+    if (usb_keyboard_send())
+        return 1;
+
+    dirty = false;
+    return 0;
+}
+
+uint8_t usb__kb__try_send_report(void) {
+    if (!dirty)
+        return 0;
+    if (usb_keyboard_try_send())
+        return 1;
+
+    dirty = false;
+    return 0;
 }
 
 void usb__kb__toggle_nkro(void) {
@@ -145,4 +174,6 @@ void usb__kb__toggle_nkro(void) {
         usb_keyboard_nkro_enable(false);
         kb__led__off(6);
     }
+
+    dirty = true;  // the keys were cleared, and the interface changed
 }
@@ -489,6 +489,12 @@ static uint8_t keyboard_idle_config=125;
 // count until idle timeout
 static uint8_t keyboard_idle_count=0;
 
+#ifdef NKRO_ENABLE
+// the same, for the nkro interface
+static uint8_t keyboard2_idle_config=125;
+static uint8_t keyboard2_idle_count=0;
+#endif
+
 // 1=num lock, 2=caps lock, 4=scroll lock, 8=compose, 16=kana
 volatile uint8_t keyboard_leds=0;
 
@@ -550,24 +556,41 @@ void usb_keyboard_nkro_enable(bool status)
 #endif
 }
 
+// write the report for the active keyboard interface to the selected
+// endpoint (which must be ready), and reset that interface's idle count
+static void keyboard_write_report(void)
+{
+	uint8_t i;
+
+	UEDATX = keyboard_modifier_keys;
+#ifdef NKRO_ENABLE
+	if (keyboard_nkro_enabled) {
+		for (i=0; i<KBD2_REPORT_KEYS; i++) {
+			UEDATX = keyboard_keys[i];
+		}
+		keyboard2_idle_count = 0;
+		return;
+	}
+#endif
+	UEDATX = 0;
+	for (i=0; i<KBD_REPORT_KEYS; i++) {
+		UEDATX = keyboard_keys[i];
+	}
+	keyboard_idle_count = 0;
+}
+
 // send the contents of keyboard_keys and keyboard_modifier_keys
-int8_t usb_keyboard_send(void)
+// - if `wait` is false, return -1 immediately if the endpoint is busy
+static int8_t keyboard_send(bool wait)
 {
-	uint8_t i, intr_state, timeout, keys_end, endpoint;
+	uint8_t intr_state, timeout, endpoint;
 
 	if (!usb_configuration) return -1;
 
 #ifdef NKRO_ENABLE
-  if (!keyboard_nkro_enabled) {
-    endpoint = KBD_ENDPOINT;
-    keys_end = KBD_REPORT_KEYS;
-  } else {
-    endpoint = KBD2_ENDPOINT;
-    keys_end = KBD2_REPORT_KEYS;
-  }
+	endpoint = keyboard_nkro_enabled ? KBD2_ENDPOINT : KBD_ENDPOINT;
 #else
 	endpoint = KBD_ENDPOINT;
-  keys_end = KBD_REPORT_KEYS;
 #endif
 
 	intr_state = SREG;
@@ -578,6 +601,8 @@ int8_t usb_keyboard_send(void)
 		// are we ready to transmit?
 		if (UEINTX & (1<<RWAL)) break;
 		SREG = intr_state;
+		// should we wait at all?
+		if (!wait) return -1;
 		// has the USB gone offline?
 		if (!usb_configuration) return -1;
 		// have we waited too long?
@@ -587,23 +612,22 @@ int8_t usb_keyboard_send(void)
 		cli();
 		UENUM = endpoint;
 	}
-	UEDATX = keyboard_modifier_keys;
-#ifdef NKRO_ENABLE
-  if (!keyboard_nkro_enabled) {
-	  UEDATX = 0;
-  }
-#else
-  UEDATX = 0;
-#endif
-	for (i=0; i<keys_end; i++) {
-		UEDATX = keyboard_keys[i];
-	}
+	keyboard_write_report();
 	UEINTX = 0x3A;
-	keyboard_idle_count = 0;
 	SREG = intr_state;
 	return 0;
 }
 
+int8_t usb_keyboard_send(void)
+{
+	return keyboard_send(true);
+}
+
+int8_t usb_keyboard_try_send(void)
+{
+	return keyboard_send(false);
+}
+
 // send mouse movement, buttons
 int8_t usb_mouse_send(int8_t x, int8_t y, int8_t wheel_v, int8_t wheel_h, uint8_t buttons)
 {
@@ -664,7 +688,7 @@ void usb_mouse_buttons(uint8_t buttons)
 //
 ISR(USB_GEN_vect)
 {
-	uint8_t intbits, i;
+	uint8_t intbits;
 	static uint8_t div4=0;
 
         intbits = UDINT;
@@ -678,22 +702,27 @@ ISR(USB_GEN_vect)
 		usb_configuration = 0;
         }
 	if ((intbits & (1<<SOFI)) && usb_configuration) {
+		if ((++div4 & 3) == 0) {
 #ifdef NKRO_ENABLE
-		if (!keyboard_nkro_enabled && keyboard_idle_config && (++div4 & 3) == 0) {
-#else
-		if (keyboard_idle_config && (++div4 & 3) == 0) {
+			if (keyboard_nkro_enabled) {
+				if (keyboard2_idle_config) {
+					UENUM = KBD2_ENDPOINT;
+					if (UEINTX & (1<<RWAL)) {
+						if (++keyboard2_idle_count == keyboard2_idle_config) {
+							keyboard_write_report();
+							UEINTX = 0x3A;
+						}
+					}
+				}
+			} else
 #endif
-			UENUM = KBD_ENDPOINT;
-			if (UEINTX & (1<<RWAL)) {
-				keyboard_idle_count++;
-				if (keyboard_idle_count == keyboard_idle_config) {
-					keyboard_idle_count = 0;
-					UEDATX = keyboard_modifier_keys;
-					UEDATX = 0;
-					for (i=0; i<6; i++) {
-						UEDATX = keyboard_keys[i];
+			if (keyboard_idle_config) {
+				UENUM = KBD_ENDPOINT;
+				if (UEINTX & (1<<RWAL)) {
+					if (++keyboard_idle_count == keyboard_idle_config) {
+						keyboard_write_report();
+						UEINTX = 0x3A;
 					}
-					UEINTX = 0x3A;
 				}
 			}
 		}
@@ -864,8 +893,8 @@ ISR(USB_COM_vect)
 					usb_wait_in_ready();
 					UEDATX = keyboard_modifier_keys;
 					UEDATX = 0;
-					for (i=0; i<6; i++) {
-						UEDATX = keyboard_keys[i];
+					for (i=0; i<KBD_REPORT_KEYS; i++) {
+						UEDATX = keyboard_nkro_enabled ? 0 : keyboard_keys[i];
 					}
 					usb_send_in();
 					return;
@@ -904,6 +933,42 @@ ISR(USB_COM_vect)
 				}
 			}
 		}
+#ifdef NKRO_ENABLE
+		if (wIndex == KBD2_INTERFACE) {
+			if (bmRequestType == 0xA1) {
+				if (bRequest == HID_GET_REPORT) {
+					usb_wait_in_ready();
+					UEDATX = keyboard_modifier_keys;
+					for (i=0; i<KBD2_REPORT_KEYS; i++) {
+						UEDATX = keyboard_nkro_enabled ? keyboard_keys[i] : 0;
+					}
+					usb_send_in();
+					return;
+				}
+				if (bRequest == HID_GET_IDLE) {
+					usb_wait_in_ready();
+					UEDATX = keyboard2_idle_config;
+					usb_send_in();
+					return;
+				}
+			}
+			if (bmRequestType == 0x21) {
+				if (bRequest == HID_SET_REPORT) {
+					usb_wait_receive_out();
+					keyboard_leds = UEDATX;
+					usb_ack_out();
+					usb_send_in();
+					return;
+				}
+				if (bRequest == HID_SET_IDLE) {
+					keyboard2_idle_config = (wValue >> 8);
+					keyboard2_idle_count = 0;
+					usb_send_in();
+					return;
+				}
+			}
+		}
+#endif
 #ifdef MOUSE_ENABLE
 		if (wIndex == MOUSE_INTERFACE) {
 			if (bmRequestType == 0xA1) {
@@ -14,6 +14,11 @@
  * - the empty macros for `usb_debug_putchar()` and `usb_debug_flush_output()`
  *   removed
  * - keycode macros removed
+ * - `usb_keyboard_try_send()` added: like `usb_keyboard_send()`, but returns
+ *   `-1` immediately if the endpoint is busy, instead of waiting for it
+ * - the idle rate set by the host (`SET_IDLE`) is honored for the nkro
+ *   interface too, and the nkro interface answers `GET_REPORT`, `GET_IDLE`,
+ *   and `SET_REPORT` (LEDs)
  */
 
 // ----------------------------------------------------------------------------
@@ -62,6 +67,7 @@ uint8_t usb_configured(void);		// is the USB port configured
 
 // keyboard
 int8_t usb_keyboard_send(void);
+int8_t usb_keyboard_try_send(void);
 extern uint8_t keyboard_modifier_keys;
 extern uint8_t keyboard_keys[REPORT_KEYS];
 extern volatile uint8_t keyboard_leds;
@@ -0,0 +1,92 @@
+/* ----------------------------------------------------------------------------
+ * Copyright (c) 2013 Ben Blazak <benblazak.dev@gmail.com>
+ * Released under The MIT License (see "doc/licenses/MIT.md")
+ * Project located at <https://github.com/benblazak/ergodox-firmware>
+ * ------------------------------------------------------------------------- */
+
+/**                                                                 description
+ * Implements the PJRC USB interface
+ * (".../atmega32u4/keyboard/from-pjrc/usb.h") for host builds
+ *
+ * The device is always configured, and every report is handed to
+ * `host__usb__report()` with the same layout it would have on the wire.  This
+ * lets the wrappers in ".../atmega32u4" be compiled unchanged.
+ */
+
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "../../host.h"
+#include "../atmega32u4/keyboard/from-pjrc/usb.h"
+
+// ----------------------------------------------------------------------------
+
+uint8_t keyboard_modifier_keys;
+uint8_t keyboard_keys[REPORT_KEYS];
+volatile uint8_t keyboard_leds;
+bool keyboard_nkro_enabled;
+
+uint8_t usb_mouse_protocol = 1;
+uint8_t mouse_buttons;
+
+// ----------------------------------------------------------------------------
+
+void usb_init(void) {
+    for (uint8_t i = 0; i < REPORT_KEYS; i++)
+        keyboard_keys[i] = 0;
+}
+
+uint8_t usb_configured(void) {
+    return 1;
+}
+
+void usb_keyboard_nkro_enable(bool status) {
+#ifdef NKRO_ENABLE
+    keyboard_nkro_enabled = status;
+
+    for (uint8_t i = 0; i < REPORT_KEYS; i++)
+        keyboard_keys[i] = 0;
+#endif
+}
+
+int8_t usb_keyboard_send(void) {
+#ifdef NKRO_ENABLE
+    if (keyboard_nkro_enabled) {
+        uint8_t report[KBD2_SIZE] = { keyboard_modifier_keys };
+        for (uint8_t i = 0; i < KBD2_REPORT_KEYS; i++)
+            report[1+i] = keyboard_keys[i];
+        host__usb__report("nkro", report, sizeof(report));
+        return 0;
+    }
+#endif
+
+    uint8_t report[KBD_SIZE] = { keyboard_modifier_keys, 0 };
+    for (uint8_t i = 0; i < KBD_REPORT_KEYS; i++)
+        report[2+i] = keyboard_keys[i];
+    host__usb__report("kb", report, sizeof(report));
+    return 0;
+}
+
+int8_t usb_keyboard_try_send(void) {
+    return usb_keyboard_send();
+}
+
+int8_t usb_mouse_send( int8_t x, int8_t y,
+                       int8_t wheel_v, int8_t wheel_h,
+                       uint8_t buttons ) {
+    mouse_buttons = buttons;
+
+    uint8_t report[MOUSE_SIZE] = {
+        buttons,
+        (uint8_t) (x == -128 ? -127 : x),
+        (uint8_t) (y == -128 ? -127 : y),
+        (uint8_t) (wheel_v == -128 ? -127 : wheel_v),
+        (uint8_t) (wheel_h == -128 ? -127 : wheel_h),
+    };
+    host__usb__report("mouse", report, usb_mouse_protocol ? 5 : 3);
+    return 0;
+}
+
+void usb_mouse_buttons(uint8_t buttons) {
+    usb_mouse_send(0, 0, 0, 0, buttons);
+}
@@ -13,6 +13,10 @@
 
 SRC += $(wildcard $(CURDIR)/$(MCU)/*.c)
 
+ifeq '$(MCU)' 'host'
+	SRC += $(wildcard $(CURDIR)/$(EMULATED_MCU)/*.c)
+endif
+
 ifeq '$(MCU)' 'atmega32u4'
 	SRC += $(wildcard $(CURDIR)/$(MCU)/keyboard/from-pjrc/*.c)
 endif
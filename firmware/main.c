@@ -16,21 +16,25 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include "../firmware/keyboard.h"
+#include "../firmware/lib/debounce.h"
+#include "../firmware/lib/profile.h"
 #include "../firmware/lib/timer.h"
 #include "../firmware/lib/usb.h"
 #include "./main.h"
 
 // ----------------------------------------------------------------------------
 
-/**                                       macros/OPT__DEBOUNCE_TIME/description
- * The minimum amount of time to wait between two scans of a key, in
- * milliseconds
+/**                                         macros/OPT__SCAN_PERIOD/description
+ * The amount of time between the start of two scans of a key, in milliseconds
  *
  * Notes:
- * - Cherry MX bounce time <= 5ms (at 16 in/sec actuation speed) (spec)
+ * - Debouncing is done per key (see ".../firmware/lib/debounce.h"), so this
+ *   can be (and should be) much shorter than the switches' bounce time.
+ * - This is only the initial value; it may be changed at runtime with
+ *   `timer__set_scan_period()`.
  */
-#ifndef OPT__DEBOUNCE_TIME
-    #error "OPT__DEBOUNCE_TIME not defined"
+#ifndef OPT__SCAN_PERIOD
+    #error "OPT__SCAN_PERIOD not defined"
 #endif
 
 // ----------------------------------------------------------------------------
@@ -43,10 +47,8 @@
 
 // ----------------------------------------------------------------------------
 
-bool (* is_pressed) [OPT__KB__ROWS][OPT__KB__COLUMNS]
-          = &( bool [OPT__KB__ROWS][OPT__KB__COLUMNS] ){};
-bool (* was_pressed) [OPT__KB__ROWS][OPT__KB__COLUMNS]
-           = &( bool [OPT__KB__ROWS][OPT__KB__COLUMNS] ){};
+uint16_t (* is_pressed) [OPT__KB__ROWS] = &( uint16_t [OPT__KB__ROWS] ){};
+uint16_t (* was_pressed) [OPT__KB__ROWS] = &( uint16_t [OPT__KB__ROWS] ){};
 
 uint8_t row;
 uint8_t col;
@@ -64,11 +66,8 @@ struct main__flags_t flags = { .update_leds = true };
  * on.
  */
 int main(void) {
-    static bool (*temp)[OPT__KB__ROWS][OPT__KB__COLUMNS]; // for swapping below
-    static bool key_is_pressed;
-    static bool key_was_pressed;
-
-    static uint8_t time_scan_started;
+    static uint16_t (*temp)[OPT__KB__ROWS];  // for swapping below
+    static uint16_t changed;
 
     kb__init();  // initialize hardware (besides USB and timer)
 
@@ -79,35 +78,39 @@ int main(void) {
     kb__led__delay__usb_init();  // give the OS time to load drivers, etc.
 
     timer__init();
+    timer__set_scan_period(OPT__SCAN_PERIOD);
 
-    kb__led__state__ready();
+    profile__init();  // (does nothing, unless the profiler is enabled)
 
-    time_scan_started  // on the first iteration, scan immediately
-        = timer__get_milliseconds() - OPT__DEBOUNCE_TIME;
+    kb__led__state__ready();
 
     for (;;) {
         temp = is_pressed;
         is_pressed = was_pressed;
         was_pressed = temp;
 
-        // delay if necessary, then rescan
-        while( (uint8_t)(timer__get_milliseconds()-time_scan_started)
-               < OPT__DEBOUNCE_TIME );
-        time_scan_started = timer__get_milliseconds();
+        // sleep until the next scan is due, then rescan
+        timer__wait_for_scan();
+        profile__start();
         kb__update_matrix(*is_pressed);
+        debounce__update(*is_pressed);
+        profile__mark(PROFILE__DEBOUNCE);
 
         // "execute" keys that have changed state
+        // - a whole row is compared at once; only the columns that changed
+        //   are visited
         for (row=0; row<OPT__KB__ROWS; row++) {
-            for (col=0; col<OPT__KB__COLUMNS; col++) {
-                key_is_pressed = (*is_pressed)[row][col];
-                key_was_pressed = (*was_pressed)[row][col];
+            changed = (*is_pressed)[row] ^ (*was_pressed)[row];
 
-                if (key_is_pressed != key_was_pressed)
-                    kb__layout__exec_key(key_is_pressed, row, col);
-            }
+            for (col=0; changed; col++, changed >>= 1)
+                if (changed & 1)
+                    kb__layout__exec_key( ((*is_pressed)[row] >> col) & 1,
+                                          row, col );
         }
+        profile__mark(PROFILE__EXEC_KEYS);
 
-        usb__kb__send_report();  // (even if nothing's changed)
+        usb__kb__try_send_report();  // (only if something's changed)
+        profile__mark(PROFILE__USB);
 
         // note: only use the `kb__led__logical...` functions here, since the
         // meaning of the physical LEDs should be controlled by the layout
@@ -124,8 +127,11 @@ int main(void) {
             #undef on
             #undef off
         }
+        profile__mark(PROFILE__LEDS);
 
         timer___tick_cycles();
+        timer___tick_milliseconds();
+        profile__mark(PROFILE__TICK);
     }
 
     return 0;
@@ -31,8 +31,8 @@ struct main__flags_t {
 
 // ----------------------------------------------------------------------------
 
-extern bool (* main__is_pressed) [OPT__KB__ROWS][OPT__KB__COLUMNS];
-extern bool (* main__was_pressed) [OPT__KB__ROWS][OPT__KB__COLUMNS];
+extern uint16_t (* main__is_pressed)  [OPT__KB__ROWS];
+extern uint16_t (* main__was_pressed) [OPT__KB__ROWS];
 
 extern uint8_t main__row;
 extern uint8_t main__col;
@@ -67,13 +67,14 @@ extern struct main__flags_t main__flags;
 
 // === main__is_pressed ===
 /**                                      variables/main__is_pressed/description
- * A matrix of `bool`s indicating whether the key at a given position is
- * currently pressed
+ * A matrix of row bitmasks indicating whether the key at a given position is
+ * currently pressed (bit `n` of a row is set if the key in column `n` is
+ * pressed)
  */
 
 // === main__was_pressed ===
 /**                                     variables/main__was_pressed/description
- * A matrix of `bool`s indicating whether the key at a given position was
+ * A matrix of row bitmasks indicating whether the key at a given position was
  * pressed on the previous scan
  */
 